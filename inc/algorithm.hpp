@@ -0,0 +1,171 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <array>
+#include <thread>
+#include <vector>
+#include <ranges>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <type_traits>
+#include "object_pool.hpp"
+
+namespace p2774 {
+	namespace internal {
+		inline
+		constexpr
+		std::size_t chunks_per_worker{4}; //! @todo optimal oversubscription?
+
+		inline
+		auto chunk_count(std::size_t size) noexcept -> std::size_t {
+			const std::size_t workers{std::max(std::thread::hardware_concurrency(), 1u)};
+			return std::min(workers * chunks_per_worker, size);
+		}
+
+		//! split range into contiguous chunks and invoke func(first, last) once per chunk
+		template<execution_policy Policy, std::ranges::random_access_range Range, typename Func>
+		requires std::ranges::sized_range<Range>
+		void for_each_chunk(Policy && policy, Range && range, Func func) {
+			const auto size{static_cast<std::size_t>(std::ranges::size(range))};
+			if(!size) return;
+
+			std::vector<std::size_t> chunks(chunk_count(size));
+			std::iota(std::begin(chunks), std::end(chunks), std::size_t{0});
+			std::for_each(std::forward<Policy>(policy), std::begin(chunks), std::end(chunks), [&, count{chunks.size()}](std::size_t chunk) {
+				const auto first{std::ranges::begin(range)};
+				func(first + static_cast<std::ranges::range_difference_t<Range>>(chunk * size / count), first + static_cast<std::ranges::range_difference_t<Range>>((chunk + 1) * size / count));
+			});
+		}
+
+		//! combine init and values pairwise as a balanced binary tree, the shape only depends on the number of values
+		template<execution_policy Policy, typename T, typename Op>
+		auto tree_reduce(Policy && policy, const std::vector<T *> & values, T init, Op & op) -> T {
+			if(values.empty()) return init;
+
+			std::vector<std::size_t> pairs(values.size() / 2);
+			std::iota(std::begin(pairs), std::end(pairs), std::size_t{0});
+			for(std::size_t stride{1}; stride < values.size(); stride *= 2) {
+				const auto count{(values.size() - stride + 2 * stride - 1) / (2 * stride)}; //pairs (i, i + stride) with i + stride < size
+				std::for_each(policy, std::begin(pairs), std::begin(pairs) + static_cast<std::ptrdiff_t>(count), [&](std::size_t pair) {
+					auto & lhs{*values[pair * 2 * stride]};
+					lhs = std::invoke(op, std::move(lhs), std::move(*values[pair * 2 * stride + stride]));
+				});
+			}
+			return std::invoke(op, std::move(init), std::move(*values.front()));
+		}
+
+		//! vectorized kernels, dispatched at runtime to the best instruction set available (see src/algorithm.cpp)
+		namespace simd {
+			auto sum(const float * values, std::size_t count) noexcept -> float;
+			auto sum(const double * values, std::size_t count) noexcept -> double;
+			auto sum(const int * values, std::size_t count) noexcept -> int;
+			auto sum(const unsigned * values, std::size_t count) noexcept -> unsigned;
+			auto sum(const long * values, std::size_t count) noexcept -> long;
+			auto sum(const unsigned long * values, std::size_t count) noexcept -> unsigned long;
+			auto sum(const long long * values, std::size_t count) noexcept -> long long;
+			auto sum(const unsigned long long * values, std::size_t count) noexcept -> unsigned long long;
+
+			void add(float * dst, const float * src, std::size_t count) noexcept;
+			void add(double * dst, const double * src, std::size_t count) noexcept;
+			void add(int * dst, const int * src, std::size_t count) noexcept;
+			void add(unsigned * dst, const unsigned * src, std::size_t count) noexcept;
+			void add(long * dst, const long * src, std::size_t count) noexcept;
+			void add(unsigned long * dst, const unsigned long * src, std::size_t count) noexcept;
+			void add(long long * dst, const long long * src, std::size_t count) noexcept;
+			void add(unsigned long long * dst, const unsigned long long * src, std::size_t count) noexcept;
+
+			template<typename T>
+			concept vectorizable = requires(T * dst, const T * src, std::size_t count) {
+				{ simd::sum(src, count) } -> std::same_as<T>;
+				simd::add(dst, src, count);
+			};
+
+			template<typename T>
+			concept vectorizable_array = requires { typename T::value_type; } && vectorizable<typename T::value_type> && std::same_as<T, std::array<typename T::value_type, std::tuple_size<T>::value>>;
+		}
+	}
+
+	//! @brief invoke func(T &, element) for every element of range, leasing only once per chunk
+	//! @note yields the same pool state as leasing per element, but performs far fewer operations on the pool
+	template<execution_policy Policy, std::ranges::random_access_range Range, typename T, typename Allocator, typename Factory, typename Func>
+	requires std::ranges::sized_range<Range> && std::invocable<Func &, T &, std::ranges::range_reference_t<Range>>
+	void for_each(Policy && policy, Range && range, const object_pool<T, Allocator, Factory> & pool, Func func) {
+		internal::for_each_chunk(std::forward<Policy>(policy), range, [&](auto first, auto last) {
+			pool.with([&](T & local) noexcept(std::is_nothrow_invocable_v<Func &, T &, std::ranges::range_reference_t<Range>>) {
+				for(; first != last; ++first) std::invoke(func, local, *first);
+			});
+		});
+	}
+
+	//! @brief accumulate reduce(T, transform(element)) for every element of range into pool (leasing once per chunk), then fold all values of pool into init
+	//! @note the initial value of the values of pool (T{} unless specified otherwise on construction of pool) must be an identity of reduce, all values of pool are reset to it afterwards
+	template<execution_policy Policy, std::ranges::random_access_range Range, typename T, typename Allocator, typename Factory, typename Reduce, typename Transform>
+	requires std::ranges::sized_range<Range>
+	auto transform_reduce(Policy && policy, Range && range, const object_pool<T, Allocator, Factory> & pool, T init, Reduce reduce, Transform transform) -> T {
+		internal::for_each_chunk(std::forward<Policy>(policy), range, [&](auto first, auto last) {
+			pool.with([&](T & local) {
+				for(; first != last; ++first) local = std::invoke(reduce, std::move(local), std::invoke(transform, *first));
+			});
+		});
+
+		pool.lease_all().consume([&](T && value) { init = std::invoke(reduce, std::move(init), std::move(value)); });
+		return init;
+	}
+
+	//! @brief combine init and all values of snapshot with op as a balanced binary tree (depth O(log n)), evaluating each level in parallel
+	//! @note op is only required to be associative, values of snapshot are merged in place and therefore reset to their initial value afterwards (like snapshot::consume)
+	template<execution_policy Policy, typename T, typename Factory, typename Op>
+	requires std::is_invocable_r_v<T, Op &, T, T>
+	auto reduce(Policy && policy, internal::snapshot<T, Factory> & snapshot, T init, Op op) -> T {
+		std::vector<T *> values;
+		for(auto & value : snapshot) values.push_back(std::addressof(value));
+		auto result{internal::tree_reduce(policy, values, std::move(init), op)};
+		std::for_each(std::forward<Policy>(policy), std::begin(values), std::end(values), [&](T * value) { snapshot.reset(*value); });
+		return result;
+	}
+
+	//! @brief combine init and all values of snapshot with op in a fixed order and tree shape, yielding bit-identical results for the same set of nodes regardless of scheduling
+	//! @note nodes are ordered by their stable index (position of their block in allocation order and slot within it, as visited by snapshot::for_each_ordered), values of snapshot are reset afterwards (like for reduce)
+	template<execution_policy Policy, typename T, typename Factory, typename Op>
+	requires std::is_invocable_r_v<T, Op &, T, T>
+	auto deterministic_reduce(Policy && policy, internal::snapshot<T, Factory> & snapshot, T init, Op op) -> T {
+		std::vector<T *> values;
+		values.reserve(snapshot.size());
+		snapshot.for_each_ordered([&](T & value) { values.push_back(std::addressof(value)); });
+		auto result{internal::tree_reduce(policy, values, std::move(init), op)};
+		std::for_each(std::forward<Policy>(policy), std::begin(values), std::end(values), [&](T * value) { snapshot.reset(*value); });
+		return result;
+	}
+
+	//! @brief sum of all values of snapshot, using vectorized kernels for arithmetic T and std::array of arithmetic T
+	//! @note for floating point T the order of additions is unspecified
+	template<typename T, typename Factory>
+	requires internal::simd::vectorizable_array<T> || std::is_invocable_r_v<T, std::plus<>, T, T>
+	auto sum(const internal::snapshot<T, Factory> & snapshot) -> T {
+		if constexpr(internal::simd::vectorizable<T>) {
+			constexpr std::size_t buffer_size{256};
+			T buffer[buffer_size];
+			std::size_t count{0};
+			T result{};
+			for(const auto & value : snapshot) { //gather scattered nodes into a contiguous buffer
+				buffer[count++] = value;
+				if(count == buffer_size) {
+					result += internal::simd::sum(buffer, count);
+					count = 0;
+				}
+			}
+			return result + internal::simd::sum(buffer, count);
+		} else if constexpr(internal::simd::vectorizable_array<T>) {
+			T result{};
+			for(const auto & value : snapshot) internal::simd::add(result.data(), value.data(), result.size());
+			return result;
+		} else return std::accumulate(snapshot.begin(), snapshot.end(), T{}, std::plus<>{});
+	}
+}
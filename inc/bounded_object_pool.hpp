@@ -0,0 +1,148 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <optional>
+#include <concepts>
+#include <coroutine>
+#include <semaphore>
+#include <type_traits>
+#include "object_pool.hpp"
+
+namespace p2774 {
+	//! @brief schedules the resumption of a coroutine, e.g. by posting it to a thread pool or event loop
+	//! @note must not resume the coroutine inline, as it is invoked by the thread that returns a node (i.e. within the destructor of a handle or snapshot)
+	template<typename Executor>
+	concept coroutine_executor = std::is_nothrow_move_constructible_v<Executor> && std::is_nothrow_invocable_v<Executor &, std::coroutine_handle<>>;
+
+	//! @brief object_pool that contains at most (about) capacity nodes, leases wait for a node to be returned instead of growing the pool beyond that
+	//! @note capacity is rounded up to whole blocks, nodes that are part of a snapshot are unavailable until the snapshot is destroyed
+	template<std::destructible T, typename Allocator = std::allocator<T>, typename Factory = void>
+	class bounded_object_pool final {
+		using pool_type = object_pool<T, Allocator, Factory>;
+		using node_type = internal::node<T>;
+
+		pool_type pool;
+		std::size_t capacity;
+
+		struct thread_waiter final : internal::waiter {
+			std::binary_semaphore ready{0};
+
+			thread_waiter() noexcept : internal::waiter{.wake = [](internal::waiter & self) noexcept { static_cast<thread_waiter &>(self).ready.release(); }} {}
+		};
+
+		//! @brief enqueue w unless a node was returned in the meantime
+		//! @return true if w must wait until a node is handed over to it
+		auto enqueue(internal::waiter & w) const noexcept -> bool {
+			auto & state{pool.state};
+			state.enqueue(w);
+			if(!state.available()) return true;
+			return !state.dequeue(w); //if w was dequeued already, a node is handed over to it
+		}
+	public:
+		using handle = typename pool_type::handle;
+		using snapshot = typename pool_type::snapshot;
+		using pending_snapshot = typename pool_type::pending_snapshot;
+
+		//! @brief construct with the same arguments as object_pool
+		template<typename... Args>
+		requires std::constructible_from<pool_type, Args...>
+		explicit
+		bounded_object_pool(std::size_t capacity, Args &&... args) : pool{std::forward<Args>(args)...}, capacity{capacity} {}
+		bounded_object_pool(const bounded_object_pool &) =delete;
+		auto operator=(const bounded_object_pool &) -> bounded_object_pool & =delete;
+		~bounded_object_pool() noexcept =default;
+
+		//! @brief lease a node, blocking until one is returned if the pool is at capacity
+		[[nodiscard]]
+		auto lease() const -> handle {
+			for(;;) {
+				if(const auto ptr{pool.lease_node(capacity)}) return handle{ptr};
+				thread_waiter w;
+				if(enqueue(w)) {
+					w.ready.acquire();
+					return handle{pool.adopt(static_cast<node_type *>(w.node))};
+				}
+			}
+		}
+
+		//! @brief lease a node, empty if the pool is at capacity and no node is available
+		[[nodiscard]]
+		auto try_lease() const -> std::optional<handle> {
+			if(const auto ptr{pool.lease_node(capacity)}) return handle{ptr};
+			return std::nullopt;
+		}
+
+		//! @brief lease a node, waiting at most rel_time for one to be returned if the pool is at capacity
+		template<typename Rep, typename Period>
+		[[nodiscard]]
+		auto try_lease_for(const std::chrono::duration<Rep, Period> & rel_time) const -> std::optional<handle> {
+			const auto deadline{std::chrono::steady_clock::now() + rel_time};
+			for(;;) {
+				if(const auto ptr{pool.lease_node(capacity)}) return handle{ptr};
+				thread_waiter w;
+				if(enqueue(w)) {
+					if(!w.ready.try_acquire_until(deadline)) {
+						if(pool.state.dequeue(w)) return std::nullopt; //timed out
+						w.ready.acquire(); //node is being handed over
+					}
+					return handle{pool.adopt(static_cast<node_type *>(w.node))};
+				}
+				if(std::chrono::steady_clock::now() >= deadline) return std::nullopt;
+			}
+		}
+
+		//! @brief awaitable lease, suspends the awaiting coroutine if the pool is at capacity
+		//! @note once the coroutine receives a node, it is passed to executor by the thread that returned the node, so its resumption never runs inside the destructor of a handle or snapshot
+		template<coroutine_executor Executor>
+		class awaiter final : internal::waiter {
+			friend
+			class bounded_object_pool;
+
+			const bounded_object_pool & owner;
+			node_type * ptr{nullptr};
+			std::coroutine_handle<> coroutine;
+			[[no_unique_address]] Executor executor;
+
+			awaiter(const bounded_object_pool & owner, Executor executor) noexcept : internal::waiter{.wake = [](internal::waiter & self) noexcept {
+				auto & w{static_cast<awaiter &>(self)};
+				auto executor{std::move(w.executor)}; //w may be destroyed as soon as the coroutine is resumed
+				executor(w.coroutine);
+			}}, owner{owner}, executor{std::move(executor)} {}
+		public:
+			awaiter(const awaiter &) =delete;
+			auto operator=(const awaiter &) -> awaiter & =delete;
+
+			auto await_ready() -> bool { return (ptr = owner.pool.lease_node(owner.capacity)); }
+			auto await_suspend(std::coroutine_handle<> coroutine) -> bool {
+				this->coroutine = coroutine;
+				for(;;) {
+					if(owner.enqueue(*this)) return true; //must not access *this afterwards, as the coroutine may already be resumed
+					if((ptr = owner.pool.lease_node(owner.capacity))) return false;
+				}
+			}
+			auto await_resume() -> handle { return handle{ptr ? ptr : owner.pool.adopt(static_cast<node_type *>(node))}; }
+		};
+
+		template<coroutine_executor Executor>
+		[[nodiscard]]
+		auto async_lease(Executor executor) const noexcept -> awaiter<Executor> { return {*this, std::move(executor)}; }
+
+		[[nodiscard]]
+		auto lease_all() const noexcept -> snapshot { return pool.lease_all(); }
+		[[nodiscard]]
+		auto lease_dirty() const noexcept -> snapshot { return pool.lease_dirty(); }
+		[[nodiscard]]
+		auto lease_epoch() const noexcept -> pending_snapshot { return pool.lease_epoch(); }
+		[[nodiscard]]
+		auto lease_all_wait() const noexcept -> snapshot { return pool.lease_all_wait(); }
+
+		void new_generation() const noexcept { pool.new_generation(); }
+	};
+}
@@ -6,18 +6,59 @@
 
 #pragma once
 #include <bit>
+#include <span>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <cassert>
+#include <compare>
 #include <cstdint>
+#include <cstring>
 #include <utility>
 #include <concepts>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <execution>
 #include <semaphore>
+#include <functional>
 #include <type_traits>
+#include <initializer_list>
+#ifdef _WIN32
+	#include <intrin.h>
+#endif
 
 namespace p2774 {
-	template<std::default_initializable T, typename Allocator>
+	template<std::destructible T, typename Allocator, typename Factory>
 	class object_pool;
 
+	template<std::destructible T, typename Allocator, typename Factory>
+	class bounded_object_pool;
+
+	template<std::destructible T, std::size_t N, typename Factory>
+	requires (N > 0)
+	class static_object_pool;
+
+	template<typename Policy>
+	concept execution_policy = std::is_execution_policy_v<std::remove_cvref_t<Policy>>;
+
+	//! @brief tag to request default-initialization (instead of value-initialization) of the values of a pool, e.g. to skip zero-filling large buffers that are overwritten anyway
+	struct for_overwrite_t final {
+		explicit
+		for_overwrite_t() noexcept =default;
+	};
+
+	inline
+	constexpr
+	for_overwrite_t for_overwrite{};
+
+	//! @brief list a snapshot returns its nodes to
+	enum class return_to {
+		active,  //!< nodes are part of subsequent snapshots
+		reserved //!< nodes are considered unused (and are therefore not part of subsequent snapshots) until they are leased again
+	};
+
 	namespace internal {
 		//! @todo 32bit support?
 		static_assert(sizeof(void *) == 8);
@@ -46,24 +87,437 @@ namespace p2774 {
 
 		inline
 		constexpr
-		std::size_t max_block_size{512}; //! @todo optimal size?
+		std::size_t cache_line_size{64};
+
+		inline
+		constexpr
+		std::size_t shard_count{16}; //! @todo optimal count?
+
+		inline
+		std::atomic<unsigned> next_shard{0};
+
+		//! @brief shard of the outstanding-lease counters used by the calling thread
+		inline
+		thread_local
+		const unsigned char shard_index{static_cast<unsigned char>(next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count)};
+
+		//! @brief thread or coroutine waiting for a node to be returned (see bounded_object_pool)
+		struct waiter {
+			waiter * next{nullptr};
+			void * node{nullptr}; //!< handed over by the thread that returned it
+			void (*wake)(waiter &) noexcept;
+		};
+
+		//! @brief state of a pool that is shared with its handles and snapshots
+		//! @note active nodes are split by epoch: handles return their node to the list of the epoch they were leased in, so lease_epoch() can switch epochs and take the nodes of the previous one once all its handles are returned
+		//! @note an epoch is only closed once all handles of the epoch before it have been returned, so the handles of at most one closed epoch are alive at any time
+		//! @note snapshots return their nodes to clean, so the list of an epoch only contains nodes that were leased since the previous snapshot
+		struct pool_state final {
+			lockfree_stack active[2], clean, reserved;
+			std::atomic<std::uint32_t> epoch{0};
+			std::atomic<std::uint32_t> generation{0}; //!< values of nodes stamped with an older generation are considered reset (see object_pool::new_generation)
+			std::atomic<bool> pending[2]{}; //!< whether the list of a closed epoch is kept for its pending_snapshot, so it is not leased from until taken
+
+			//! handles alive (low half) and calls of leave() in progress (high half) per epoch, sharded by the thread that leased them to avoid contention
+			struct alignas(cache_line_size) shard final {
+				std::atomic<std::uint64_t> outstanding[2]{};
+			} shards[shard_count];
+
+			static
+			constexpr
+			std::uint64_t leaving{std::uint64_t{1} << 32};
+
+			std::atomic<std::uint32_t> waiters{0}, notifications{0};
+
+			//! waiters for returned nodes, in FIFO order
+			std::binary_semaphore queue_lock{1};
+			waiter * first{nullptr}, * last{nullptr};
+			std::atomic<std::size_t> queued{0};
+
+			pool_state() noexcept =default;
+			pool_state(const pool_state &) =delete;
+			auto operator=(const pool_state &) -> pool_state & =delete;
+			~pool_state() noexcept =default;
+
+			auto current() const noexcept -> unsigned { return epoch.load() & 1; }
+
+			//! @brief check whether a lease may find a node without allocating
+			auto available() const noexcept -> bool { return (!pending[0].load() && active[0].load().head) || (!pending[1].load() && active[1].load().head) || clean.load().head || reserved.load().head; }
+
+			//! @brief register a lease in the current epoch (on shard_index)
+			auto enter() noexcept -> unsigned {
+				auto & outstanding{shards[shard_index].outstanding};
+				for(;;) {
+					const auto e{current()};
+					outstanding[e].fetch_add(1);
+					if(current() == e) return e; //epoch did not switch => closing it will wait for us
+					leave(e, shard_index);
+				}
+			}
+			//! @note the handle is counted as leaving until its notification is done, waiters that may destroy the state afterwards wait for that via settle()
+			void leave(unsigned e, unsigned char shard) noexcept {
+				auto & outstanding{shards[shard].outstanding[e]};
+				outstanding.fetch_add(leaving - 1);
+				if(waiters.load()) [[unlikely]] {
+					notifications.fetch_add(1);
+					notifications.notify_all();
+				}
+				outstanding.fetch_sub(leaving); //last access to the state
+			}
+
+			auto drained(unsigned e) const noexcept -> bool {
+				return std::all_of(std::begin(shards), std::end(shards), [&](const auto & shard) { return !(shard.outstanding[e].load() & (leaving - 1)); });
+			}
+
+			//! @brief check that no call of leave() is in progress
+			auto settled() const noexcept -> bool {
+				return std::all_of(std::begin(shards), std::end(shards), [](const auto & shard) { return shard.outstanding[0].load() < leaving && shard.outstanding[1].load() < leaving; });
+			}
+
+			//! @brief wait until the calls of leave() that returned the handles waited for are done, which takes at most a few instructions each
+			void settle() const noexcept { while(!settled()) std::this_thread::yield(); }
+
+			//! @brief block until pred() holds, re-evaluating it whenever a handle is returned
+			void wait_until(auto pred) noexcept {
+				waiters.fetch_add(1);
+				for(;;) {
+					const auto seen{notifications.load()};
+					if(pred()) break;
+					notifications.wait(seen);
+				}
+				waiters.fetch_sub(1);
+			}
+
+			void enqueue(waiter & w) noexcept {
+				queue_lock.acquire();
+				w.next = nullptr;
+				(last ? last->next : first) = &w;
+				last = &w;
+				queued.fetch_add(1);
+				queue_lock.release();
+			}
+
+			//! @return false if w was already dequeued by a thread that hands over a node to it
+			auto dequeue(waiter & w) noexcept -> bool {
+				queue_lock.acquire();
+				waiter * prev{nullptr};
+				auto ptr{first};
+				while(ptr && ptr != &w) {
+					prev = ptr;
+					ptr = ptr->next;
+				}
+				if(ptr) {
+					(prev ? prev->next : first) = w.next;
+					if(last == &w) last = prev;
+					queued.fetch_sub(1);
+				}
+				queue_lock.release();
+				return ptr;
+			}
+
+			//! @brief close epoch e (i.e. switch to the next one) if all handles of the epoch before it have been returned
+			//! @return true if e is closed (by this or an earlier call)
+			auto try_close(std::uint32_t e) noexcept -> bool {
+				if(auto current{epoch.load()}; current == e) {
+					if(!drained((e + 1) & 1)) return false; //switching now would mix the remaining handles of the previous epoch with new ones
+					epoch.compare_exchange_strong(current, e + 1);
+				}
+				return true;
+			}
+
+			//! @brief close epoch e if possible, then check if all handles leased in (or before) it have been returned
+			//! @note never blocks, once true it stays true
+			auto try_drain(std::uint32_t e) noexcept -> bool {
+				if(!try_close(e)) return false;
+				return epoch.load() != e + 1 || drained(e & 1); //closing a later epoch required e to be drained
+			}
+
+			//! @brief close the current epoch and block until all handles leased before have been returned
+			void quiesce() noexcept {
+				const auto e{epoch.load()};
+				wait_until([&] { return try_drain(e); });
+				settle();
+			}
+		};
+
+
+		inline
+		void prefetch(const void * ptr) noexcept {
+#ifdef _WIN32
+			_mm_prefetch(static_cast<const char *>(ptr), _MM_HINT_T0);
+#else
+			__builtin_prefetch(ptr);
+#endif
+		}
+
+		inline
+		constexpr
+		std::size_t prefetch_distance{8}; //! @todo optimal distance?
+
+
+		inline
+		constexpr
+		std::size_t min_block_size{512}; //! @todo optimal size?
 
 		template<typename T>
 		struct node final {
-			T value{};
+			union { T value; }; //!< constructed on the first lease of the node (see block_header::touched)
 			node * next{nullptr};
+			node * tail{this}; //!< node further down the list, the bottom of the list if tail == this (see extent)
+			std::uint32_t count{1}; //!< number of nodes from this node to tail (both included)
+			unsigned char epoch{0}; //!< epoch the node was last leased in
+			unsigned char shard{0}; //!< shard the lease of the node was counted in
+			std::atomic<std::uint32_t> generation{0}; //!< generation the value was last reset in
+
+			node() noexcept {}
+			node(const node &) =delete;
+			auto operator=(const node &) -> node & =delete;
+			~node() noexcept {} //value is destroyed by its pool
+		};
+
+		//! @brief values that can be read while being written, without cooperation of the writer
+		template<typename T>
+		concept atomically_readable = std::is_trivially_copyable_v<T> && std::atomic_ref<T>::is_always_lock_free;
+
+		//! @brief replace value with the one constructed by construct, by destroying and reconstructing it (so T need not be assignable)
+		//! @tparam Nothrow whether construct never throws
+		//! @note value is unchanged if construct throws, unless T is not nothrow move constructible, then it is left destroyed (see initializer::strong_reset)
+		template<bool Nothrow, typename T, typename Construct>
+		void reconstruct(T & value, Construct construct) {
+			if constexpr(Nothrow || !std::is_nothrow_move_constructible_v<T>) {
+				std::destroy_at(std::addressof(value));
+				construct(std::addressof(value));
+			} else {
+				union storage {
+					T value;
+					storage() noexcept {}
+					~storage() noexcept {}
+				} tmp;
+				construct(std::addressof(tmp.value));
+				std::destroy_at(std::addressof(value));
+				std::construct_at(std::addressof(value), std::move(tmp.value));
+				std::destroy_at(std::addressof(tmp.value));
+			}
+		}
+
+		//! @brief initial value of the values of a pool, produced by invoking Factory
+		template<typename T, typename Factory>
+		class initializer final {
+			[[no_unique_address]] mutable Factory factory;
+		public:
+			static
+			constexpr
+			bool strong_reset{std::is_nothrow_invocable_v<Factory &> || std::is_nothrow_move_constructible_v<T>}; //!< whether a throwing reset leaves the value unchanged (instead of destroyed)
+
+			initializer() noexcept(std::is_nothrow_default_constructible_v<Factory>) requires std::default_initializable<Factory> =default;
+			initializer(Factory factory) noexcept(std::is_nothrow_move_constructible_v<Factory>) : factory{std::move(factory)} {}
+
+			//! @brief construct the initial value at ptr
+			void construct(T * ptr) const { ::new(static_cast<void *>(ptr)) T(std::invoke(factory)); } //guaranteed copy elision
+
+			//! @brief restore the initial value of value
+			void reset(T & value) const { reconstruct<std::is_nothrow_invocable_v<Factory &>>(value, [&](T * ptr) { construct(ptr); }); }
+		};
+
+		//! @brief initial value of the values of a pool without factory, i.e. value-initialized, default-initialized or copied from a prototype
+		template<typename T>
+		class initializer<T, void> final {
+			std::unique_ptr<const T> prototype; //!< empty if values are value-initialized (or default-initialized)
+			void (*copy)(T *, const T &){nullptr}; //!< copies prototype, only instantiated by the constructor taking it, so T need not be copyable otherwise
+			bool overwrite{false};
+		public:
+			initializer() noexcept =default;
+			initializer(for_overwrite_t) noexcept : overwrite{true} {}
+			initializer(const T & prototype) requires std::copy_constructible<T> : prototype{std::make_unique<const T>(prototype)}, copy{[](T * ptr, const T & prototype) { std::construct_at(ptr, prototype); }} {}
+
+			//! @brief construct the initial value at ptr
+			void construct(T * ptr) const {
+				if(prototype) copy(ptr, *prototype);
+				else if constexpr(std::default_initializable<T>) { //otherwise there is always a prototype
+					if(overwrite) ::new(static_cast<void *>(ptr)) T;
+					else std::construct_at(ptr);
+				}
+			}
+
+			static
+			constexpr
+			bool strong_reset{(std::is_nothrow_default_constructible_v<T> && std::is_nothrow_copy_constructible_v<T>) || std::is_nothrow_move_constructible_v<T>}; //!< whether a throwing reset leaves the value unchanged (instead of destroyed)
+
+			//! @brief restore the initial value of value, which is value-initialized (even for for_overwrite) unless there is a prototype
+			void reset(T & value) const {
+				reconstruct<std::is_nothrow_default_constructible_v<T> && std::is_nothrow_copy_constructible_v<T>>(value, [&](T * ptr) {
+					if(prototype) copy(ptr, *prototype);
+					else if constexpr(std::default_initializable<T>) std::construct_at(ptr);
+				});
+			}
+		};
+
+		//! @brief push the list [first, last] to stack
+		//! @note the nodes above last must track last (or a node below it) as their tail, last takes over the tail of the top of stack (so pushing is O(1))
+		template<typename T>
+		void push(lockfree_stack & stack, node<T> * first, node<T> * last) noexcept {
+			for(auto old{stack.load()};;) {
+				const auto top{static_cast<node<T> *>(old.head)};
+				last->next = top;
+				last->tail = top ? top->tail : last;
+				last->count = top ? top->count + 1 : 1;
+				if(stack.compare_exchange(old, {first, old.tag + 1}))
+					break; //inserted
+			}
+		}
+
+		//! @brief number of nodes and bottom of the (detached) list starting at first
+		//! @note follows the tails, i.e. one hop per list that was pushed as a whole (e.g. by a snapshot) onto a non-empty stack since the list was last detached
+		template<typename T>
+		auto extent(node<T> * first) noexcept -> std::pair<std::size_t, node<T> *> {
+			std::size_t count{first->count};
+			auto last{first->tail};
+			for(; last->tail != last; last = last->tail) count += last->count - 1;
+			return {count, last};
+		}
+
+		//! @brief pop top of stack, nullptr if stack is empty
+		template<typename T>
+		auto pop(lockfree_stack & stack) noexcept -> node<T> * {
+			for(auto old{stack.load()}; old.head;)
+				if(stack.compare_exchange(old, {static_cast<node<T> *>(old.head)->next, old.tag + 1}))
+					return static_cast<node<T> *>(old.head);
+			return nullptr;
+		}
+
+		//! @brief detach all nodes of stack
+		inline
+		auto pop_all(lockfree_stack & stack) noexcept -> void * {
+			auto old{stack.load()};
+			while(old.head) {
+				if(stack.compare_exchange(old, {nullptr, old.tag + 1}))
+					break;
+			}
+			//got head or head is nullptr
+			return old.head;
+		}
+
+		struct block_header {
+			pool_state * owner{nullptr}; //!< state of the pool the block belongs to
+			std::uint32_t index{0}; //!< position in allocation order
+			std::uint32_t unused{0}; //!< number of reserved nodes, only used by object_pool::shrink_to_fit (under lock)
+			std::atomic<std::uint64_t> touched{0}; //!< bitmap of nodes that were leased at least once, which are exactly the nodes whose value is constructed
 		};
 
+		//! @brief size of a block of T, enlarged for large T (e.g. per-worker buffers) so that a block holds at least two nodes
 		template<typename T>
 		constexpr
-		std::size_t nodes_per_block{(internal::max_block_size - sizeof(void *)) / sizeof(node<T>)};
+		std::size_t block_size{std::max(min_block_size, std::bit_ceil(sizeof(block_header) + sizeof(void *) + 2 * sizeof(node<T>)))};
 
 		template<typename T>
-		struct block final {
-			block * next{nullptr};
+		constexpr
+		std::size_t nodes_per_block{(block_size<T> - sizeof(block_header) - sizeof(void *)) / sizeof(node<T>)};
+
+		//! @note blocks are aligned to their size, so the block (and therefore the stable index) of any node can be derived from its address
+		template<typename T>
+		struct alignas(block_size<T>) block final : block_header {
+			std::atomic<block *> next{nullptr}; //!< read concurrently by object_pool::peek
 			static_assert(nodes_per_block<T> > 1);
+			static_assert(nodes_per_block<T> <= 64); //must fit into touched
 			node<T> nodes[nodes_per_block<T>];
 		};
+		static_assert(sizeof(block<std::size_t>) == min_block_size);
+
+		//! @brief pools of T embed their first block, so pools with low concurrency never allocate
+		//! @note only for blocks of regular size, as larger ones would bloat every pool
+		template<typename T>
+		constexpr
+		bool has_embedded_block{block_size<T> == min_block_size};
+
+		//! @brief uninitialized storage for a single block
+		template<typename T>
+		struct alignas(block<T>) block_storage final {
+			std::byte bytes[sizeof(block<T>)];
+		};
+
+		struct no_block_storage final {};
+
+		template<typename T>
+		auto block_of(const void * ptr) noexcept -> block<T> * { return std::bit_cast<block<T> *>(std::bit_cast<std::uintptr_t>(ptr) & ~std::uintptr_t{block_size<T> - 1}); }
+
+		template<typename T>
+		auto slot_of(const void * ptr) noexcept -> std::size_t { return (std::bit_cast<std::uintptr_t>(ptr) - std::bit_cast<std::uintptr_t>(&block_of<T>(ptr)->nodes[0])) / sizeof(node<T>); }
+
+		//! @brief index of the node containing value, stable for the lifetime of the pool and independent of scheduling
+		template<typename T>
+		auto stable_index(const T & value) noexcept -> std::size_t { return block_of<T>(std::addressof(value))->index * nodes_per_block<T> + slot_of<T>(std::addressof(value)); }
+
+		template<typename T>
+		auto is_touched(const node<T> * ptr) noexcept -> bool { return block_of<T>(ptr)->touched.load(std::memory_order_relaxed) & (std::uint64_t{1} << slot_of<T>(ptr)); }
+
+		//! @brief record that a node is leased for the first time, after its value was constructed
+		template<typename T>
+		void mark_touched(const node<T> * ptr) noexcept { block_of<T>(ptr)->touched.fetch_or(std::uint64_t{1} << slot_of<T>(ptr), std::memory_order_release); }
+
+		//! @brief record that the value of a node was destroyed by a failed reset, so it is constructed again on its next lease
+		template<typename T>
+		void clear_touched(const node<T> * ptr) noexcept { block_of<T>(ptr)->touched.fetch_and(~(std::uint64_t{1} << slot_of<T>(ptr)), std::memory_order_relaxed); }
+
+		//! @brief nodes of a single block that are part of a snapshot, in address order
+		template<typename T>
+		class block_nodes final {
+			template<typename, typename>
+			friend
+			class snapshot;
+
+			block<std::remove_const_t<T>> * ptr;
+			std::uint64_t bits;
+
+			block_nodes(block<std::remove_const_t<T>> * ptr, std::uint64_t bits) noexcept : ptr{ptr}, bits{bits} {}
+		public:
+			struct iterator final {
+				using iterator_category = std::forward_iterator_tag;
+				using value_type        = std::remove_const_t<T>;
+				using difference_type   = std::ptrdiff_t;
+				using pointer           = T *;
+				using reference         = T &;
+
+				iterator() noexcept =default;
+
+				auto operator++() noexcept -> iterator & {
+					assert(mask);
+					mask &= mask - 1; //clear lowest bit
+					return *this;
+				}
+				auto operator++(int) noexcept -> iterator {
+					auto tmp{*this};
+					++*this;
+					return tmp;
+				}
+
+				auto operator*() const noexcept -> reference {
+					assert(mask);
+					return ptr->nodes[std::countr_zero(mask)].value;
+				}
+				auto operator->() const noexcept -> pointer { return std::addressof(**this); }
+
+				friend
+				auto operator==(const iterator & lhs, const iterator & rhs) noexcept -> bool { return lhs.mask == rhs.mask; }
+			private:
+				friend
+				class block_nodes;
+
+				iterator(block<value_type> * ptr, std::uint64_t mask) noexcept : ptr{ptr}, mask{mask} {}
+
+				block<value_type> * ptr{nullptr};
+				std::uint64_t mask{0};
+			};
+			static_assert(std::forward_iterator<iterator>);
+
+			auto begin() const noexcept -> iterator { return {ptr, bits}; }
+			auto end() const noexcept -> iterator { return {}; }
+
+			auto size() const noexcept -> std::size_t { return static_cast<std::size_t>(std::popcount(bits)); }
+			//! @brief all nodes of the block, the ones of the snapshot are those i with (mask() >> i) & 1
+			//! @note all other nodes must not be accessed, as they may be leased concurrently or not even be constructed
+			auto nodes() const noexcept -> std::span<std::conditional_t<std::is_const_v<T>, const node<std::remove_const_t<T>>, node<T>>, nodes_per_block<std::remove_const_t<T>>> { return ptr->nodes; }
+			auto mask() const noexcept -> std::uint64_t { return bits; }
+		};
 
 
 		template<typename T>
@@ -96,7 +550,7 @@ namespace p2774 {
 			friend
 			auto operator==(const iterator &, const iterator &) noexcept -> bool =default;
 		private:
-			template<typename>
+			template<typename, typename>
 			friend
 			class snapshot;
 
@@ -106,65 +560,233 @@ namespace p2774 {
 		};
 
 
+		template<typename T>
+		struct indexed_iterator final {
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type        = std::remove_const_t<T>;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = T *;
+			using reference         = T &;
+
+			indexed_iterator() noexcept =default;
+
+			auto operator++() noexcept -> indexed_iterator & {
+				++ptr;
+				return *this;
+			}
+			auto operator++(int) noexcept -> indexed_iterator {
+				auto tmp{*this};
+				++*this;
+				return tmp;
+			}
+			auto operator--() noexcept -> indexed_iterator & {
+				--ptr;
+				return *this;
+			}
+			auto operator--(int) noexcept -> indexed_iterator {
+				auto tmp{*this};
+				--*this;
+				return tmp;
+			}
+
+			auto operator+=(difference_type n) noexcept -> indexed_iterator & {
+				ptr += n;
+				return *this;
+			}
+			auto operator-=(difference_type n) noexcept -> indexed_iterator & {
+				ptr -= n;
+				return *this;
+			}
+			friend
+			auto operator+(indexed_iterator it, difference_type n) noexcept -> indexed_iterator { return it += n; }
+			friend
+			auto operator+(difference_type n, indexed_iterator it) noexcept -> indexed_iterator { return it += n; }
+			friend
+			auto operator-(indexed_iterator it, difference_type n) noexcept -> indexed_iterator { return it -= n; }
+			friend
+			auto operator-(const indexed_iterator & lhs, const indexed_iterator & rhs) noexcept -> difference_type { return lhs.ptr - rhs.ptr; }
+
+			auto operator*() const noexcept -> reference {
+				assert(ptr);
+				return (*ptr)->value;
+			}
+			auto operator->() const noexcept -> pointer { return std::addressof(**this); }
+			auto operator[](difference_type n) const noexcept -> reference { return *(*this + n); }
+
+			friend
+			auto operator==(const indexed_iterator &, const indexed_iterator &) noexcept -> bool =default;
+			friend
+			auto operator<=>(const indexed_iterator &, const indexed_iterator &) noexcept -> std::strong_ordering =default;
+		private:
+			template<typename, typename>
+			friend
+			class snapshot;
+
+			indexed_iterator(node<value_type> * const * ptr) noexcept : ptr{ptr} {}
+
+			node<value_type> * const * ptr{nullptr};
+		};
+
+
+		//! @brief hand a node of list to the first waiter of owner, if there is none the node is returned to list
+		//! @note called after returning nodes to list whenever owner has waiters, waiters check the lists after enqueuing themselves so no returned node is missed
+		template<typename T>
+		void hand_over(pool_state & owner, lockfree_stack & list) noexcept {
+			const auto ptr{internal::pop<T>(list)};
+			if(!ptr) return; //taken by another thread, which hands it over once it is returned
+			owner.queue_lock.acquire();
+			const auto w{owner.first};
+			if(!w) {
+				internal::push(list, ptr, ptr); //still under lock, so waiters that enqueue afterwards observe it
+				owner.queue_lock.release();
+				return;
+			}
+			owner.first = w->next;
+			if(!owner.first) owner.last = nullptr;
+			owner.queued.fetch_sub(1);
+			owner.queue_lock.release();
+			w->node = ptr;
+			w->wake(*w);
+		}
+
+		//! @brief return a leased node to the pool it belongs to
+		template<typename T>
+		void release(node<T> * ptr) noexcept {
+			auto & owner{*block_of<T>(ptr)->owner};
+			const auto epoch{ptr->epoch}, shard{ptr->shard};
+			auto & list{ptr->generation.load(std::memory_order_relaxed) == owner.generation.load(std::memory_order_relaxed) ? owner.active[epoch] : owner.reserved}; //values of a previous generation are reset on their next lease
+			internal::push(list, ptr, ptr);
+			if(owner.queued.load()) [[unlikely]] internal::hand_over<T>(owner, list);
+			owner.leave(epoch, shard); //last access, as returning the last handle may allow the pool to be destroyed
+		}
+
 		template<typename T>
 		class handle final {
-			template<std::default_initializable, typename>
+			template<std::destructible, typename, typename>
 			friend
 			class p2774::object_pool;
+			template<std::destructible, typename, typename>
+			friend
+			class p2774::bounded_object_pool;
 
-			internal::lockfree_stack & owner;
-			node<T> * ptr;
+			node<T> * ptr{nullptr}; //!< owning pool is derived via the block of the node
 
-			handle(internal::lockfree_stack & owner, node<T> * ptr) noexcept : owner{owner}, ptr{ptr} {}
+			explicit
+			handle(node<T> * ptr) noexcept : ptr{ptr} {}
 		public:
+			//! @brief handle that doesn't own a node
+			handle() noexcept =default;
 			handle(const handle &) =delete;
-			handle(handle && other) noexcept =delete;
+			handle(handle && other) noexcept : ptr{std::exchange(other.ptr, nullptr)} {}
 			auto operator=(const handle &) -> handle & =delete;
-			auto operator=(handle &&) noexcept -> handle & =delete;
-
-			~handle() noexcept {
-				//push to stack
-				for(auto old{owner.load()};;) {
-					ptr->next = static_cast<node<T> *>(old.head);
-					if(owner.compare_exchange(old, {ptr, old.tag + 1}))
-						break; //inserted
-				}
+			auto operator=(handle && other) noexcept -> handle & {
+				handle tmp{std::move(other)};
+				std::swap(ptr, tmp.ptr);
+				return *this; //previous node is returned by tmp
 			}
 
-			auto operator*() const noexcept -> T & { return ptr->value; }
+			~handle() noexcept { if(ptr) internal::release(ptr); }
+
+			explicit
+			operator bool() const noexcept { return ptr; }
+
+			auto operator*() const noexcept -> T & {
+				assert(ptr);
+				return ptr->value;
+			}
 			auto operator->() const noexcept -> T * { return get(); }
 			auto get() const noexcept -> T *{ return std::addressof(**this); }
 		};
 
 
-		template<typename T>
+		template<typename T, typename Factory>
+		class pending_snapshot;
+
+		template<typename T, typename Factory = void>
 		class snapshot final {
-			template<std::default_initializable, typename>
+			template<std::destructible, typename, typename>
 			friend
 			class p2774::object_pool;
+			friend
+			class pending_snapshot<T, Factory>;
 
-			internal::lockfree_stack & owner;
-			node<T> * head;
+			internal::pool_state * owner{nullptr};
+			const initializer<T, Factory> * init{nullptr};
+			node<T> * head{nullptr}, * tail{nullptr};
+			std::size_t count{0};
+			return_to target{return_to::active};
+			mutable std::vector<std::pair<block<T> *, std::uint64_t>> members; //!< nodes of the snapshot per block, indexed by the position of the block in allocation order (see membership)
 
-			snapshot(internal::lockfree_stack & owner, node<T> * ptr) noexcept : owner{owner}, head{ptr} {}
+			//! @brief take the detached lists, chaining them via the tail and count tracked by their nodes (so taking and returning the snapshot and size() are O(1) instead of walking the nodes)
+			snapshot(internal::pool_state & owner, const initializer<T, Factory> & init, std::initializer_list<void *> lists) noexcept : owner{&owner}, init{&init} {
+				for(auto it{std::rbegin(lists)}; it != std::rend(lists); ++it) //back to front, so the lists below are already chained
+					if(const auto first{static_cast<node<T> *>(*it)}) {
+						const auto [n, last]{internal::extent(first)};
+						if(head) { //join with the lists below
+							last->next = head;
+							last->tail = tail;
+							last->count = static_cast<std::uint32_t>(count + 1);
+						} else tail = last;
+						first->tail = tail; //shortcut for the next time the list is detached
+						first->count = static_cast<std::uint32_t>(n + count);
+						head = first;
+						count += n;
+					}
+			}
 		public:
+			//! @brief empty snapshot that doesn't belong to any pool
+			snapshot() noexcept =default;
 			snapshot(const snapshot &) =delete;
-			snapshot(snapshot && other) noexcept =delete;
+			snapshot(snapshot && other) noexcept : owner{other.owner}, init{other.init}, head{std::exchange(other.head, nullptr)}, tail{std::exchange(other.tail, nullptr)}, count{std::exchange(other.count, 0)}, target{other.target}, members{std::move(other.members)} {}
 			auto operator=(const snapshot &) -> snapshot & =delete;
-			auto operator=(snapshot &&) noexcept -> snapshot & =delete;
+			auto operator=(snapshot && other) noexcept -> snapshot & {
+				snapshot tmp{std::move(other)};
+				swap(tmp);
+				return *this; //previous nodes are returned by tmp
+			}
 
 			~snapshot() noexcept {
-				auto tail{head};
-				for(; tail->next; tail = tail->next);
-
-				//push list to stack
-				for(auto old{owner.load()};;) {
-					tail->next = static_cast<node<T> *>(old.head);
-					if(owner.compare_exchange(old, {head, old.tag + 1}))
-						break; //inserted
+				if(!head) return;
+				auto & list{target == return_to::reserved ? owner->reserved : owner->clean};
+				internal::push(list, head, tail);
+				for(auto n{std::min<std::size_t>(owner->queued.load(), count)}; n--;) internal::hand_over<T>(*owner, list);
+			}
+
+			void swap(snapshot & other) noexcept {
+				std::swap(owner, other.owner);
+				std::swap(init, other.init);
+				std::swap(head, other.head);
+				std::swap(tail, other.tail);
+				std::swap(count, other.count);
+				std::swap(target, other.target);
+				std::swap(members, other.members);
+			}
+			friend
+			void swap(snapshot & lhs, snapshot & rhs) noexcept { lhs.swap(rhs); }
+
+			//! @brief invoke func with every value (as rvalue) and reset it to its initial value directly afterwards, e.g. at the boundary of two phases of an iterative algorithm
+			//! @param target list the (now reset) nodes are returned to once the snapshot is destroyed
+			//! @note terminates if resetting a value throws and T is not nothrow move constructible, as the node would remain in the snapshot without a value
+			template<typename Func>
+			requires std::invocable<Func &, T &&>
+			void consume(Func func, return_to target = return_to::active) {
+				this->target = target;
+				for(auto ptr{head}; ptr; ptr = ptr->next) {
+					std::invoke(func, std::move(ptr->value));
+					reset(ptr->value);
 				}
 			}
 
+			//! @brief restore the initial value of value, which must be a value of this snapshot (e.g. after an algorithm merged it into another one)
+			//! @note terminates under the same condition as consume()
+			void reset(T & value) const {
+				if constexpr(initializer<T, Factory>::strong_reset) init->reset(value);
+				else [&]() noexcept { init->reset(value); }();
+			}
+
+			auto size() const noexcept -> std::size_t { return count; }
+			auto empty() const noexcept -> bool { return !head; }
+
 			using iterator       = internal::iterator<T>;
 			static_assert(std::forward_iterator<iterator>);
 			using const_iterator = internal::iterator<const T>;
@@ -177,121 +799,587 @@ namespace p2774 {
 
 			auto cbegin() const noexcept -> const_iterator { return begin(); }
 			auto cend() const noexcept -> const_iterator { return end(); }
+
+			//! @brief random-access (and therefore splittable) view of a snapshot, e.g. for parallel algorithms
+			//! @note only valid as long as the snapshot it was created from
+			template<typename U>
+			class basic_indexed final {
+				friend
+				class snapshot;
+
+				std::vector<node<T> *> nodes;
+
+				basic_indexed(node<T> * head, std::size_t count) {
+					nodes.reserve(count);
+					for(; head; head = head->next) nodes.push_back(head);
+				}
+			public:
+				using iterator = indexed_iterator<U>;
+				static_assert(std::random_access_iterator<iterator>);
+
+				auto begin() const noexcept -> iterator { return nodes.data(); }
+				auto end() const noexcept -> iterator { return nodes.data() + nodes.size(); }
+
+				auto size() const noexcept -> std::size_t { return nodes.size(); }
+				auto empty() const noexcept -> bool { return nodes.empty(); }
+				auto operator[](std::size_t index) const noexcept -> U & { return nodes[index]->value; }
+			};
+			using indexed       = basic_indexed<T>;
+			using const_indexed = basic_indexed<const T>;
+
+			[[nodiscard]]
+			auto index() const -> const_indexed { return {head, count}; }
+			[[nodiscard]]
+			auto index()       -> indexed { return {head, count}; }
+
+			//! @name Bulk export
+			//! @brief copy/move all values (in iteration order) to out, which must provide at least size() elements
+			//! @return number of values written
+			//! @{
+			auto copy_to(std::span<T> out) const noexcept(std::is_nothrow_copy_assignable_v<T>) -> std::size_t {
+				assert(out.size() >= count);
+				auto it{out.begin()};
+				for(auto ptr{head}; ptr; ptr = ptr->next, ++it)
+					if constexpr(std::is_trivially_copyable_v<T>) std::memcpy(std::addressof(*it), std::addressof(ptr->value), sizeof(T));
+					else *it = ptr->value;
+				return count;
+			}
+			template<execution_policy Policy>
+			auto copy_to(Policy && policy, std::span<T> out) const -> std::size_t {
+				assert(out.size() >= count);
+				const auto indexed{index()};
+				std::copy(std::forward<Policy>(policy), indexed.begin(), indexed.end(), out.begin());
+				return count;
+			}
+
+			auto move_to(std::span<T> out) noexcept(std::is_nothrow_move_assignable_v<T>) -> std::size_t {
+				if constexpr(std::is_trivially_copyable_v<T>) return copy_to(out);
+				else {
+					assert(out.size() >= count);
+					auto it{out.begin()};
+					for(auto ptr{head}; ptr; ptr = ptr->next, ++it) *it = std::move(ptr->value);
+					return count;
+				}
+			}
+			template<execution_policy Policy>
+			auto move_to(Policy && policy, std::span<T> out) -> std::size_t {
+				assert(out.size() >= count);
+				const auto indexed{index()};
+				std::move(std::forward<Policy>(policy), indexed.begin(), indexed.end(), out.begin());
+				return count;
+			}
+			//! @}
+
+			//! @brief invoke func for every value, visiting the nodes grouped by block (in allocation order of the blocks and address order within them, i.e. by stable_index) while prefetching ahead
+			//! @note visits the same values as iterating the snapshot, but is bound by memory bandwidth instead of latency for large snapshots
+			//! @note the first block-wise traversal of a snapshot records its nodes per block by a single pass over the links (and must therefore not run concurrently with another one), later ones only visit the recorded nodes
+			template<typename Func>
+			void for_each_ordered(Func func) const { for_each_ordered_impl<const T>(func); }
+			template<typename Func>
+			void for_each_ordered(Func func)       { for_each_ordered_impl<T>(func); }
+
+			//! @brief invoke func with the block_nodes of every block that contains nodes of the snapshot, in allocation order of the blocks
+			//! @note provides contiguous access to the same values as iterating the snapshot, the blocks are recorded like for for_each_ordered (and shared with it)
+			template<typename Func>
+			void for_each_block(Func func) const { for_each_block_impl<const T>(func); }
+			template<typename Func>
+			void for_each_block(Func func)       { for_each_block_impl<T>(func); }
+		private:
+			//! @brief nodes of the snapshot per block, recorded on first use
+			auto membership() const -> const std::vector<std::pair<block<T> *, std::uint64_t>> & {
+				if(members.empty())
+					for(auto ptr{head}; ptr; ptr = ptr->next) {
+						const auto container{block_of<T>(ptr)};
+						if(container->index >= members.size()) members.resize(std::max<std::size_t>(container->index + 1, 2 * members.size())); //blocks are usually visited newest first, so this rarely grows
+						auto & entry{members[container->index]};
+						entry.first = container;
+						entry.second |= std::uint64_t{1} << slot_of<T>(ptr);
+					}
+				return members;
+			}
+
+			template<typename U, typename Func>
+			void for_each_ordered_impl(Func & func) const {
+				const auto & blocks{membership()};
+				auto next{std::begin(blocks)};
+				block<T> * ahead{nullptr};
+				std::uint64_t pending{0};
+				const auto prefetch_next{[&] { //prefetch the node prefetch_distance nodes ahead of the visited one
+					for(; !pending && next != std::end(blocks); ++next) {
+						ahead = next->first;
+						pending = next->second;
+					}
+					if(!pending) return;
+					internal::prefetch(std::addressof(ahead->nodes[std::countr_zero(pending)].value));
+					pending &= pending - 1;
+				}};
+
+				for(std::size_t i{0}; i < prefetch_distance; ++i) prefetch_next();
+				for(const auto & [ptr, mask] : blocks)
+					for(auto bits{mask}; bits; bits &= bits - 1) {
+						prefetch_next();
+						func(static_cast<U &>(ptr->nodes[std::countr_zero(bits)].value));
+					}
+			}
+
+			template<typename U, typename Func>
+			void for_each_block_impl(Func & func) const {
+				for(const auto & [ptr, mask] : membership())
+					if(mask) func(block_nodes<U>{ptr, mask});
+			}
+		};
+
+		//! @brief snapshot of the active nodes of a closed epoch, which can be taken once all handles leased in that epoch have been returned
+		template<typename T, typename Factory = void>
+		class pending_snapshot final {
+			template<std::destructible, typename, typename>
+			friend
+			class p2774::object_pool;
+
+			internal::pool_state * owner;
+			const initializer<T, Factory> * init;
+			std::uint32_t epoch;
+
+			pending_snapshot(internal::pool_state & owner, const initializer<T, Factory> & init, std::uint32_t epoch) noexcept : owner{&owner}, init{&init}, epoch{epoch} {}
+		public:
+			//! @brief check (without blocking) whether all handles leased in the closed epoch have been returned, i.e. whether get() returns immediately
+			auto ready() const noexcept -> bool { return owner->try_drain(epoch) && owner->settled(); }
+
+			//! @brief wait until ready(), then take the active nodes of the closed epoch and all clean nodes
+			//! @note must not be called while the calling thread holds a handle leased before the switch, poll ready() instead (e.g. for periodic aggregation in long-lived services)
+			[[nodiscard]]
+			auto get() const noexcept -> snapshot<T, Factory> {
+				owner->wait_until([&] { return owner->try_drain(epoch); });
+				owner->settle();
+				snapshot<T, Factory> result{*owner, *init, {internal::pop_all(owner->active[epoch & 1]), internal::pop_all(owner->clean)}};
+				owner->pending[epoch & 1].store(false);
+				return result;
+			}
 		};
 	}
 
-	template<std::default_initializable T, typename Allocator = std::allocator<T>>
+	//! @tparam Allocator must honor the alignment of the (over-aligned) blocks it is rebound to, as the block of a node is derived from its address (std::allocator does)
+	//! @tparam Factory type of the function object that produces the initial values (void if values are value-initialized, default-initialized or copied from a prototype)
+	template<std::destructible T, typename Allocator = std::allocator<T>, typename Factory = void>
 	class object_pool final {
+		static_assert(std::is_void_v<Factory> || std::is_invocable_r_v<T, std::add_lvalue_reference_t<Factory>>);
+
 		using node = internal::node<T>;
 		using block = internal::block<T>;
 		using allocator_traits = std::allocator_traits<Allocator>::template rebind_traits<block>;
 		using allocator_type = typename allocator_traits::allocator_type;
 
-		mutable internal::lockfree_stack active, reserved;
+		template<std::destructible, typename, typename>
+		friend
+		class bounded_object_pool;
+		template<std::destructible, std::size_t N, typename>
+		requires (N > 0)
+		friend
+		class static_object_pool;
 
-		mutable block * blocks{nullptr};
+		mutable internal::pool_state state;
+
+		mutable std::atomic<block *> blocks{nullptr};
 		mutable std::binary_semaphore lock{1};
 		[[no_unique_address]] mutable allocator_type allocator;
+		internal::initializer<T, Factory> init;
+		mutable std::size_t node_count{0}; //!< nodes of all blocks, guarded by lock
+		[[no_unique_address]] mutable std::conditional_t<internal::has_embedded_block<T>, internal::block_storage<T>, internal::no_block_storage> embedded;
+		mutable bool embedded_used{false}; //!< guarded by lock, the embedded block is never freed before the pool
+		mutable node * retired{nullptr}; //!< first node of every block unlinked by shrink_to_fit that has not been freed yet, guarded by lock
+		mutable std::uint32_t retired_epoch{0}; //!< epoch that must be drained before the retired blocks are freed, guarded by lock
+
+		//! peek() calls in progress, on a cache line of its own so that peeking never writes to one that leases use
+		struct alignas(internal::cache_line_size) reader_count final {
+			std::atomic<std::size_t> count{0};
+		};
+		mutable reader_count readers;
+
+		auto is_embedded(const block * ptr) const noexcept -> bool {
+			if constexpr(internal::has_embedded_block<T>) return static_cast<const void *>(ptr) == embedded.bytes;
+			else return false;
+		}
 
-		auto allocate_new_block() const -> internal::handle<T> {
+		//! @brief construct a new (empty) block, preferring the embedded one
+		auto construct_block() const -> block * {
+			if constexpr(internal::has_embedded_block<T>)
+				if(!embedded_used) {
+					embedded_used = true;
+					return std::construct_at(reinterpret_cast<block *>(embedded.bytes));
+				}
+			auto ptr{allocator_traits::allocate(allocator, 1)};
+			if(std::bit_cast<std::uintptr_t>(ptr) % alignof(block)) [[unlikely]] { //block_of would derive a wrong block for its nodes
+				allocator_traits::deallocate(allocator, ptr, 1);
+				throw std::bad_alloc{};
+			}
+			allocator_traits::construct(allocator, ptr); //only initializes the links, values are constructed on demand
+			return ptr;
+		}
+
+		//! @brief allocate a new block and push its nodes to reserved, except for the first one if keep_first (which is constructed and returned instead)
+		auto allocate_new_block(bool keep_first) const -> node * {
 			//only called under lock ... actually need to allocate after all...
 
-			auto block{allocator_traits::allocate(allocator, 1)};
-			try {
-				allocator_traits::construct(allocator, block);
-
-				//register block & link new nodes
-				block->next = blocks;
-				blocks = block;
-				for(std::size_t i{1}; i < internal::nodes_per_block<T>; ++i) block->nodes[i].next = block->nodes + i + 1;
-
-				//insert new nodes into stack
-				for(auto old{reserved.load()};;) {
-					block->nodes[internal::nodes_per_block<T> - 1].next = static_cast<node *>(old.head);
-					if(reserved.compare_exchange(old, {block->nodes + 1, old.tag + 1}))
-						break;
+			auto block{construct_block()};
+			if(keep_first)
+				try {
+					init.construct(std::addressof(block->nodes[0].value));
+				} catch(...) {
+					deallocate_block(block);
+					throw;
 				}
 
-				return {active, block->nodes}; //we kept the first node for ourselves
+			//register block & link new nodes
+			const auto next{blocks.load(std::memory_order_relaxed)};
+			block->owner = &state;
+			block->index = next ? next->index + 1 : 0;
+			block->next.store(next, std::memory_order_relaxed);
+			block->touched.store(keep_first ? 1 : 0, std::memory_order_relaxed); //first node is leased immediately
+			const auto first{block->nodes + (keep_first ? 1 : 0)}, last{block->nodes + internal::nodes_per_block<T> - 1};
+			const auto generation{state.generation.load(std::memory_order_relaxed)};
+			for(auto ptr{block->nodes}; ptr <= last; ++ptr) {
+				ptr->next = ptr + 1;
+				ptr->tail = last;
+				ptr->count = static_cast<std::uint32_t>(last - ptr + 1);
+				ptr->generation.store(generation, std::memory_order_relaxed);
+			}
+
+			//insert new nodes into stack
+			internal::push(state.reserved, first, last);
+			blocks.store(block, std::memory_order_release);
+			node_count += internal::nodes_per_block<T>;
+
+			return block->nodes; //we kept the first node for ourselves
+		}
+
+		//! @brief destroy all constructed values of ptr and free it
+		void deallocate_block(block * ptr) const noexcept {
+			for(auto mask{ptr->touched.load()}; mask; mask &= mask - 1) std::destroy_at(std::addressof(ptr->nodes[std::countr_zero(mask)].value));
+			if(is_embedded(ptr)) {
+				std::destroy_at(ptr);
+				embedded_used = false;
+			} else {
+				allocator_traits::destroy(allocator, ptr);
+				allocator_traits::deallocate(allocator, ptr, 1);
+			}
+		}
+
+		//! @brief allocate blocks until the pool contains at least count nodes and construct the values of all nodes, so that leases neither allocate nor construct
+		//! @note values that were constructed before an exception are destroyed by the destructor (as they are marked as touched)
+		void reserve_constructed(std::size_t count) const {
+			const guard guard{lock};
+			while(node_count < count) allocate_new_block(false);
+			for(auto ptr{blocks.load(std::memory_order_relaxed)}; ptr; ptr = ptr->next.load(std::memory_order_relaxed))
+				for(auto & node : ptr->nodes)
+					if(!internal::is_touched(&node)) {
+						init.construct(std::addressof(node.value));
+						internal::mark_touched(&node);
+					}
+		}
+
+		//! @brief free the retired blocks once no lease (or peek()) that may still access them is running
+		//! @return number of bytes released
+		auto release_retired() const noexcept -> std::size_t {
+			if(!retired) return 0;
+			std::atomic_thread_fence(std::memory_order_seq_cst); //peek() calls that start after this load the unlinked blocks
+			if(readers.count.load() || !state.try_drain(retired_epoch)) return 0;
+			std::size_t released{0};
+			for(auto ptr{std::exchange(retired, nullptr)}; ptr;) {
+				const auto next{ptr->next};
+				deallocate_block(internal::block_of<T>(ptr));
+				released += sizeof(block);
+				ptr = next;
+			}
+			return released;
+		}
+
+		//! @brief construct the value of a node that is leased for the first time
+		void touch(node * ptr) const {
+			if(internal::is_touched(ptr)) return;
+			try {
+				init.construct(std::addressof(ptr->value));
+			} catch(...) {
+				internal::push(state.reserved, ptr, ptr);
+				if(state.queued.load()) [[unlikely]] internal::hand_over<T>(state, state.reserved); //ptr may have been handed over to us, the next waiter must not miss it
+				throw;
+			}
+			ptr->generation.store(state.generation.load(std::memory_order_relaxed), std::memory_order_relaxed); //freshly constructed, prepare must not reset it again
+			internal::mark_touched(ptr);
+		}
+
+		auto acquire(unsigned epoch, std::size_t limit) const -> node * {
+			//pop from stack or allocate new node if stack is empty (and the pool contains less than limit nodes)
+retry:
+			//check for reusable node (preferring the ones already used in this epoch), skipping lists kept for a pending_snapshot
+			for(const auto e : {epoch, epoch ^ 1})
+				if(!state.pending[e].load())
+					if(const auto ptr{internal::pop<T>(state.active[e])})
+						return ptr;
+			if(const auto ptr{internal::pop<T>(state.clean)})
+				return ptr;
+
+			//check reserved nodes
+			if(const auto ptr{internal::pop<T>(state.reserved)}) {
+				touch(ptr);
+				return ptr; //object is now considered active...
+			}
+
+			//may need new node
+			if(!limit) return nullptr;
+			const guard guard{lock};
+
+			//got lock ... get top again to check whether allocation is actually necessary
+			if(state.available()) [[likely]]
+				goto retry; //another thread made object(s) available previously...
+
+			if(node_count >= limit) return nullptr;
+			return allocate_new_block(true);
+		}
+
+		class guard final {
+			std::binary_semaphore & lock;
+		public:
+			guard(std::binary_semaphore & lock) noexcept : lock{lock} { lock.acquire(); }
+			~guard() noexcept { lock.release(); }
+		};
+
+		//! @brief lease a node, ownership is passed to the caller
+		//! @return nullptr if no node is available and the pool already contains limit nodes
+		auto lease_node(std::size_t limit = SIZE_MAX) const -> node * {
+			const auto epoch{state.enter()};
+			node * ptr;
+			try {
+				ptr = acquire(epoch, limit);
 			} catch(...) {
-				allocator_traits::deallocate(allocator, block, 1);
+				state.leave(epoch, internal::shard_index);
+				throw;
+			}
+			if(!ptr) {
+				state.leave(epoch, internal::shard_index);
+				return nullptr;
+			}
+			return prepare(ptr, epoch);
+		}
+
+		//! @brief lease a node that was handed over by the thread that returned it
+		auto adopt(node * ptr) const -> node * {
+			touch(ptr);
+			return prepare(ptr, state.enter());
+		}
+
+		//! @brief prepare ptr for a lease that is counted in epoch
+		auto prepare(node * ptr, unsigned epoch) const -> node * {
+			try {
+				ptr->epoch = static_cast<unsigned char>(epoch);
+				ptr->shard = internal::shard_index;
+				if(const auto generation{state.generation.load(std::memory_order_relaxed)}; ptr->generation.load(std::memory_order_relaxed) != generation) { //value belongs to a previous generation
+					init.reset(ptr->value);
+					ptr->generation.store(generation, std::memory_order_relaxed);
+				}
+				return ptr;
+			} catch(...) { //node is still stale, or its value was destroyed by the failed reset
+				if constexpr(!internal::initializer<T, Factory>::strong_reset) internal::clear_touched(ptr);
+				internal::push(state.reserved, ptr, ptr);
+				if(state.queued.load()) [[unlikely]] internal::hand_over<T>(state, state.reserved); //ptr may have been handed over to us, the next waiter must not miss it
+				state.leave(epoch, internal::shard_index);
 				throw;
 			}
 		}
 	public:
 		using handle = internal::handle<T>;
-		using snapshot = internal::snapshot<T>;
+		using snapshot = internal::snapshot<T, Factory>;
+		using pending_snapshot = internal::pending_snapshot<T, Factory>;
+		static_assert(sizeof(handle) == sizeof(void *));
 
-		object_pool(const Allocator & alloc = Allocator{}) noexcept : allocator{alloc} {}
+		object_pool(const Allocator & alloc = Allocator{}) noexcept requires std::is_void_v<Factory> && std::default_initializable<T> : allocator{alloc} {}
+		//! @brief pool whose values are default-initialized on their first lease, i.e. trivial T is left uninitialized
+		//! @note values are still reset to T{} by snapshot::consume and new_generation (by destroying and value-initializing them)
+		object_pool(for_overwrite_t, const Allocator & alloc = Allocator{}) noexcept requires std::is_void_v<Factory> && std::default_initializable<T> : allocator{alloc}, init{for_overwrite} {}
+		//! @brief pool whose values are initialized (and reset) as copies of prototype, e.g. for T that is not default-initializable
+		object_pool(std::type_identity_t<const T &> prototype, const Allocator & alloc = Allocator{}) requires std::is_void_v<Factory> && std::copy_constructible<T> : allocator{alloc}, init{prototype} {}
+		//! @brief pool whose values are initialized (and reset) with the result of factory(), which is invoked directly (i.e. without type erasure)
+		template<std::same_as<Factory> F = Factory>
+		object_pool(F factory, const Allocator & alloc = Allocator{}) noexcept(std::is_nothrow_move_constructible_v<F>) : allocator{alloc}, init{std::move(factory)} {}
+		//! @brief pool whose values are initialized (and reset) with the result of Factory{}()
+		object_pool(const Allocator & alloc = Allocator{}) noexcept(std::is_nothrow_default_constructible_v<Factory>) requires std::default_initializable<Factory> : allocator{alloc} {}
 		object_pool(const object_pool &) =delete;
 		auto operator=(const object_pool &) -> object_pool & =delete;
 		~object_pool() noexcept {
-			for(auto ptr{blocks}; ptr;) {
+			for(auto ptr{blocks.load()}; ptr;) {
+				auto next{ptr->next.load()};
+				deallocate_block(ptr);
+				ptr = next;
+			}
+			for(auto ptr{retired}; ptr;) {
 				auto next{ptr->next};
-				allocator_traits::destroy(allocator, ptr);
-				allocator_traits::deallocate(allocator, ptr, 1);
+				deallocate_block(internal::block_of<T>(ptr));
 				ptr = next;
 			}
 		}
 
 		[[nodiscard]]
-		auto lease() const -> handle {
-			//pop from stack or allocate new node if stack is empty
-retry:
-			//check for reusable node
-			for(auto old{active.load()}; old.head;)
-				if(active.compare_exchange(old, {static_cast<node *>(old.head)->next, old.tag + 1}))
-					return {active, static_cast<node *>(old.head)}; //hand ownership to handle
+		auto lease() const -> handle { return handle{lease_node()}; }
 
-			//check reserved nodes
-			for(auto old{reserved.load()}; old.head;)
-				if(reserved.compare_exchange(old, {static_cast<node *>(old.head)->next, old.tag + 1}))
-					return {active, static_cast<node *>(old.head)}; //hand ownership to handle, object is now considered active...
+		//! @brief like lease(), but never allocates a new block and therefore never blocks
+		//! @return empty if all nodes of the pool are leased or part of a snapshot
+		[[nodiscard]]
+		auto try_lease() const -> std::optional<handle> {
+			if(const auto ptr{lease_node(0)}) return handle{ptr};
+			return std::nullopt;
+		}
 
-			//may need new node
-			const class guard final {
-				std::binary_semaphore & lock;
-			public:
-				guard(std::binary_semaphore & lock) noexcept : lock{lock} { lock.acquire(); }
-				~guard() noexcept { lock.release(); }
-			} guard{lock};
+		//! @brief lease a node, invoke func with its value and return the node directly afterwards
+		//! @note unlike lease() no handle is involved for nothrow func, leaving no unwinding path between invoking func and returning the node (e.g. for fully inlined accumulation in hot loops)
+		template<typename Func>
+		requires std::invocable<Func &, T &>
+		void with(Func func) const {
+			const auto ptr{lease_node()};
+			if constexpr(std::is_nothrow_invocable_v<Func &, T &>) {
+				std::invoke(func, ptr->value);
+				internal::release(ptr);
+			} else {
+				const handle owner{ptr};
+				std::invoke(func, ptr->value);
+			}
+		}
 
-			//got lock ... get top again to check whether allocation is actually necessary
-			if(active.load().head || reserved.load().head) [[likely]]
-				goto retry; //another thread made object(s) available previously...
+		//! @brief allocate blocks until the pool contains at least count nodes, e.g. to avoid growing the pool in the first parallel region
+		void reserve(std::size_t count) const {
+			const guard guard{lock};
+			while(node_count < count) allocate_new_block(false);
+		}
+
+		//! @brief free all (allocated) blocks whose nodes are all reserved, i.e. neither leased nor part of a snapshot since they were last returned to reserved
+		//! @return number of bytes released by this call
+		//! @note never blocks: the blocks are removed from the pool immediately, but only freed once all handles leased before the call are returned and no peek() call is in progress, otherwise by a later call or the destructor
+		auto shrink_to_fit() const noexcept -> std::size_t {
+			const guard guard{lock};
+			auto released{release_retired()};
+			const auto head{static_cast<node *>(internal::pop_all(state.reserved))};
+			if(!head) return released;
+
+			for(auto ptr{head}; ptr; ptr = ptr->next) ++internal::block_of<T>(ptr)->unused;
+			const auto releasable{[&](block * ptr) { return ptr->unused == internal::nodes_per_block<T> && !is_embedded(ptr); }};
+
+			//return nodes of blocks that are kept, retire releasable blocks via their first node
+			node * kept{nullptr}, * last_kept{nullptr};
+			for(auto ptr{head}; ptr;) {
+				const auto next{ptr->next};
+				if(!releasable(internal::block_of<T>(ptr))) {
+					ptr->next = kept;
+					if(!kept) last_kept = ptr;
+					ptr->tail = last_kept;
+					ptr->count = kept ? kept->count + 1 : 1;
+					kept = ptr;
+				} else if(!internal::slot_of<T>(ptr)) {
+					ptr->next = retired;
+					retired = ptr;
+				}
+				ptr = next;
+			}
+			if(kept) internal::push(state.reserved, kept, last_kept);
 
-			return allocate_new_block();
+			//unlink releasable blocks, keeping their own links intact for peek() calls that are currently visiting them
+			for(auto link{&blocks}; const auto ptr{link->load(std::memory_order_relaxed)};)
+				if(releasable(ptr)) {
+					link->store(ptr->next.load(std::memory_order_relaxed), std::memory_order_release);
+					node_count -= internal::nodes_per_block<T>;
+				} else {
+					ptr->unused = 0;
+					link = &ptr->next;
+				}
+
+			//grace period: leases that may still access detached nodes are counted in this epoch or before (peek() calls that may still visit unlinked blocks are counted in readers)
+			retired_epoch = state.epoch.load();
+			return released + release_retired();
+		}
+
+		//! @brief logically reset all values to their initial value in O(1), e.g. at the boundary of two phases of an iterative algorithm
+		//! @note values are reset lazily (by destroying and reconstructing them, so T need not be assignable) once their node is leased again, until then they are reserved (and therefore not part of any snapshot) and skipped by peek
+		//! @note handles must not be leased or returned concurrently, as their values may still be counted towards the new generation
+		void new_generation() const noexcept {
+			state.generation.fetch_add(1); //handles returned from now on return their node to reserved
+			snapshot stale{state, init, {internal::pop_all(state.active[0]), internal::pop_all(state.active[1]), internal::pop_all(state.clean)}};
+			stale.target = return_to::reserved;
 		}
 
+		//! @brief take all active and clean nodes, i.e. all nodes that were leased at least once and are not leased or part of another snapshot (except those of a previous generation)
+		//! @note never waits, nodes of handles that are alive are part of a later snapshot (see lease_epoch() for a snapshot that includes them)
 		[[nodiscard]]
-		auto lease_all() const noexcept -> snapshot {
-			//swap head of stack with nullptr
-			auto old{active.load()};
-			while(old.head) {
-				if(active.compare_exchange(old, {nullptr, old.tag + 1}))
-					break;
+		auto lease_all() const noexcept -> snapshot { return {state, init, {internal::pop_all(state.active[0]), internal::pop_all(state.active[1]), internal::pop_all(state.clean)}}; }
+
+		//! @brief like lease_all(), but only take the nodes that were leased since the previous snapshot of this pool was taken
+		//! @note cost is proportional to the number of these nodes, not to the size of the pool
+		[[nodiscard]]
+		auto lease_dirty() const noexcept -> snapshot { return {state, init, {internal::pop_all(state.active[0]), internal::pop_all(state.active[1])}}; }
+
+		//! @brief switch to a new epoch without waiting, the returned pending_snapshot provides all active nodes of the previous epoch once all handles leased in it have been returned
+		//! @note nodes leased after the switch are part of the new epoch, even if they were last used in the previous one
+		//! @note if the handles of the epoch before are still alive (as a previous pending_snapshot was not ready yet), the switch is deferred until they are returned
+		//! @note the active nodes of the previous epoch are not leased again until they are taken by get(), so leases in the meantime use clean or reserved nodes (or allocate)
+		[[nodiscard]]
+		auto lease_epoch() const noexcept -> pending_snapshot {
+			const auto e{state.epoch.load()};
+			state.pending[e & 1].store(true); //before closing, so leases of the next epoch observe it
+			(void)state.try_close(e);
+			return {state, init, e};
+		}
+
+		//! @brief wait until all handles leased before the call have been returned, then take all active nodes (like lease_all())
+		//! @note handles leased after the call are not waited for, so the wait is bounded even while workers keep leasing (e.g. to replace a barrier at the end of a parallel region)
+		//! @note blocks via std::atomic::wait, must therefore not be called while the calling thread holds a handle of this pool
+		[[nodiscard]]
+		auto lease_all_wait() const noexcept -> snapshot {
+			state.quiesce();
+			return lease_all();
+		}
+
+		//! @brief invoke func with a copy of the value of every node that was leased at least once, including currently leased ones (e.g. in-flight counters)
+		//! @note does not take or modify any node, so it may be called at any time (e.g. for live monitoring), the only write is to a reader count on a cache line of its own (so blocks removed by a concurrent shrink_to_fit() are not freed while being visited)
+		//! @note only for values that can be read atomically, which are read via std::atomic_ref with relaxed ordering: values are only guaranteed to be observed untorn if the holders of currently leased handles write them via std::atomic_ref as well (e.g. std::atomic_ref{*handle}.fetch_add(1, std::memory_order_relaxed)), plain writes race with peek()
+		template<typename Func>
+		requires internal::atomically_readable<T> && std::invocable<Func &, T>
+		void peek(Func func) const {
+			readers.count.fetch_add(1);
+			try {
+				const auto generation{state.generation.load()};
+				for(auto ptr{blocks.load(std::memory_order_acquire)}; ptr; ptr = ptr->next.load(std::memory_order_acquire))
+					for(auto mask{ptr->touched.load(std::memory_order_acquire)}; mask; mask &= mask - 1)
+						if(auto & node{ptr->nodes[std::countr_zero(mask)]}; node.generation.load(std::memory_order_relaxed) == generation) //others are reset
+							func(std::atomic_ref<T>{node.value}.load(std::memory_order_relaxed));
+			} catch(...) {
+				readers.count.fetch_sub(1);
+				throw;
 			}
-			//got head or head is nullptr
-			return {active, static_cast<node *>(old.head)};
+			readers.count.fetch_sub(1);
 		}
 
 		//! @name Debugging
 		//! @{
 		auto active_node_count() const noexcept -> std::size_t { //not thread-safe!
 			std::size_t count{0};
-			for(auto ptr{static_cast<node *>(active.load().head)}; ptr; ptr = ptr->next) ++count;
+			for(const auto & list : {&state.active[0], &state.active[1], &state.clean})
+				for(auto ptr{static_cast<node *>(list->load().head)}; ptr; ptr = ptr->next) ++count;
 			return count;
 		}
 		auto reserved_node_count() const noexcept -> std::size_t { //not thread-safe!
 			std::size_t count{0};
-			for(auto ptr{static_cast<node *>(reserved.load().head)}; ptr; ptr = ptr->next) ++count;
+			for(auto ptr{static_cast<node *>(state.reserved.load().head)}; ptr; ptr = ptr->next) ++count;
 			return count;
 		}
 		auto block_count() const noexcept -> std::size_t { //not thread-safe!
 			std::size_t count{0};
-			for(auto ptr{blocks}; ptr; ptr = ptr->next) ++count;
+			for(auto ptr{blocks.load()}; ptr; ptr = ptr->next.load()) ++count;
 			return count;
 		}
 		//! @}
 	};
+
+	template<typename Factory>
+	requires std::invocable<Factory &>
+	object_pool(Factory) -> object_pool<std::invoke_result_t<Factory &>, std::allocator<std::invoke_result_t<Factory &>>, Factory>;
+
+	template<typename Factory, typename Allocator>
+	requires std::invocable<Factory &>
+	object_pool(Factory, const Allocator &) -> object_pool<std::invoke_result_t<Factory &>, Allocator, Factory>;
 }
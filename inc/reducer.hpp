@@ -0,0 +1,100 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <memory>
+#include <utility>
+#include <execution>
+#include <functional>
+#include <type_traits>
+#include "algorithm.hpp"
+
+namespace p2774 {
+	//! @name Properties of combine operations
+	//! @brief specialize to enable parallel (and reordering) combine strategies for custom operations
+	//! @{
+	template<typename Op>
+	struct is_associative : std::false_type {};
+
+	template<typename Op>
+	struct is_commutative : std::false_type {};
+
+	template<typename T> struct is_associative<std::plus<T>> : std::true_type {};
+	template<typename T> struct is_associative<std::multiplies<T>> : std::true_type {};
+	template<typename T> struct is_associative<std::bit_and<T>> : std::true_type {};
+	template<typename T> struct is_associative<std::bit_or<T>> : std::true_type {};
+	template<typename T> struct is_associative<std::bit_xor<T>> : std::true_type {};
+
+	template<typename T> struct is_commutative<std::plus<T>> : std::true_type {};
+	template<typename T> struct is_commutative<std::multiplies<T>> : std::true_type {};
+	template<typename T> struct is_commutative<std::bit_and<T>> : std::true_type {};
+	template<typename T> struct is_commutative<std::bit_or<T>> : std::true_type {};
+	template<typename T> struct is_commutative<std::bit_xor<T>> : std::true_type {};
+
+	template<typename Op>
+	inline
+	constexpr
+	bool is_associative_v{is_associative<Op>::value};
+
+	template<typename Op>
+	inline
+	constexpr
+	bool is_commutative_v{is_commutative<Op>::value};
+	//! @}
+
+
+	//! @brief per-worker accumulators of type T, initialized by Identity{}() and combined with Op
+	template<typename T, typename Identity, typename Op = std::plus<>, typename Allocator = std::allocator<T>>
+	requires std::default_initializable<Identity> && std::is_invocable_r_v<T, const Identity &> && std::is_invocable_r_v<T, const Op &, T, T>
+	class reducer final {
+		using pool_type = object_pool<T, Allocator, Identity>;
+
+		pool_type pool;
+		[[no_unique_address]] Op op;
+	public:
+		class local_reference final {
+			friend
+			class reducer;
+
+			typename pool_type::handle handle;
+
+			local_reference(const pool_type & pool) : handle{pool.lease()} {}
+		public:
+			local_reference(const local_reference &) =delete;
+			auto operator=(const local_reference &) -> local_reference & =delete;
+
+			auto operator*() const noexcept -> T & { return *handle; }
+			auto operator->() const noexcept -> T * { return get(); }
+			auto get() const noexcept -> T * { return std::addressof(**this); }
+		};
+
+		reducer(const Op & op = Op{}, const Allocator & alloc = Allocator{}) noexcept : pool{alloc}, op{op} {}
+		reducer(const reducer &) =delete;
+		auto operator=(const reducer &) -> reducer & =delete;
+		~reducer() noexcept =default;
+
+		//! @brief accumulator of the calling worker, released once the returned object is destroyed
+		[[nodiscard]]
+		auto local() const -> local_reference { return {pool}; }
+
+		//! @brief fold all accumulators with Op and reset them to Identity{}() in a single pass
+		auto combine() const -> T {
+			T result{Identity{}()};
+			pool.lease_all().consume([&](T && value) { result = std::invoke(op, std::move(result), std::move(value)); });
+			return result;
+		}
+
+		//! @brief fold all accumulators with Op as a parallel tree reduction (see p2774::reduce), resetting them to Identity{}()
+		//! @note only reorders (and parallelizes) the fold if Op is known to be associative and commutative
+		template<execution_policy Policy>
+		auto combine(Policy && policy) const -> T {
+			if constexpr(is_associative_v<Op> && is_commutative_v<Op>) {
+				auto snapshot{pool.lease_all()};
+				return p2774::reduce(std::forward<Policy>(policy), snapshot, T{Identity{}()}, op);
+			} else return combine();
+		}
+	};
+}
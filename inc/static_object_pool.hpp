@@ -0,0 +1,103 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <new>
+#include <span>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <concepts>
+#include "object_pool.hpp"
+
+namespace p2774 {
+	namespace internal {
+		//! @brief hands out consecutive chunks of a fixed arena and never frees them
+		template<typename T>
+		class arena_allocator final {
+			template<typename>
+			friend
+			class arena_allocator;
+
+			std::span<std::byte> * arena; //!< remaining storage, shared by all copies
+		public:
+			using value_type = T;
+
+			arena_allocator(std::span<std::byte> & arena) noexcept : arena{&arena} {}
+			template<typename U>
+			arena_allocator(const arena_allocator<U> & other) noexcept : arena{other.arena} {}
+
+			auto allocate(std::size_t count) -> T * {
+				void * ptr{arena->data()};
+				auto space{arena->size()};
+				if(!std::align(alignof(T), sizeof(T) * count, ptr, space)) throw std::bad_alloc{};
+				*arena = {static_cast<std::byte *>(ptr) + sizeof(T) * count, space - sizeof(T) * count};
+				return static_cast<T *>(ptr);
+			}
+			void deallocate(T *, std::size_t) noexcept {} //storage is owned by the arena
+
+			friend
+			auto operator==(const arena_allocator & lhs, const arena_allocator & rhs) noexcept -> bool { return lhs.arena == rhs.arena; }
+		};
+	}
+
+	//! @brief object_pool of (at least) N nodes that are allocated inline on construction, e.g. for latency-critical paths
+	//! @note all values are constructed on construction, so leasing never allocates, constructs or blocks, lease_all() and its variants behave as for object_pool
+	//! @note leasing is lock-free but not wait-free, i.e. a lease may retry an unbounded number of times under contention (while other leases make progress)
+	//! @note values are still reset (by reconstructing them from their initial value) on their next lease after new_generation(), and by snapshot::consume
+	template<std::destructible T, std::size_t N, typename Factory = void>
+	requires (N > 0)
+	class static_object_pool final {
+		using allocator_type = internal::arena_allocator<T>;
+		using pool_type = object_pool<T, allocator_type, Factory>;
+
+		static
+		constexpr
+		std::size_t block_count{(N + internal::nodes_per_block<T> - 1) / internal::nodes_per_block<T>};
+
+		std::array<internal::block_storage<T>, block_count - (internal::has_embedded_block<T> ? 1 : 0)> storage; //first block is embedded into pool
+		std::span<std::byte> arena{std::as_writable_bytes(std::span{storage})};
+		pool_type pool;
+	public:
+		using handle = typename pool_type::handle;
+		using snapshot = typename pool_type::snapshot;
+		using pending_snapshot = typename pool_type::pending_snapshot;
+
+		//! @brief construct with the same arguments as object_pool (apart from the allocator)
+		template<typename... Args>
+		requires std::constructible_from<pool_type, Args..., const allocator_type &>
+		explicit
+		static_object_pool(Args &&... args) : pool{std::forward<Args>(args)..., allocator_type{arena}} { pool.reserve_constructed(N); }
+		static_object_pool(const static_object_pool &) =delete;
+		auto operator=(const static_object_pool &) -> static_object_pool & =delete;
+		~static_object_pool() noexcept =default;
+
+		//! @brief number of nodes of the pool, N rounded up to whole blocks
+		static
+		constexpr
+		auto capacity() noexcept -> std::size_t { return block_count * internal::nodes_per_block<T>; }
+
+		//! @brief lease a node, empty if all nodes are leased or part of a snapshot
+		[[nodiscard]]
+		auto try_lease() const -> std::optional<handle> { return pool.try_lease(); }
+
+		[[nodiscard]]
+		auto lease_all() const noexcept -> snapshot { return pool.lease_all(); }
+		[[nodiscard]]
+		auto lease_dirty() const noexcept -> snapshot { return pool.lease_dirty(); }
+		[[nodiscard]]
+		auto lease_epoch() const noexcept -> pending_snapshot { return pool.lease_epoch(); }
+		[[nodiscard]]
+		auto lease_all_wait() const noexcept -> snapshot { return pool.lease_all_wait(); }
+
+		void new_generation() const noexcept { pool.new_generation(); }
+
+		template<typename Func>
+		void peek(Func func) const { pool.peek(func); }
+	};
+}
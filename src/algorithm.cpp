@@ -0,0 +1,55 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "algorithm.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+	#define P2774_SIMD_DISPATCH [[gnu::target_clones("avx512f", "avx2", "default")]]
+	#define P2774_SIMD_INLINE [[gnu::always_inline]] inline
+#else
+	#define P2774_SIMD_DISPATCH
+	#define P2774_SIMD_INLINE inline
+#endif
+
+namespace p2774::internal::simd {
+	namespace {
+		template<typename T>
+		P2774_SIMD_INLINE
+		auto sum_impl(const T * values, std::size_t count) noexcept -> T {
+			constexpr std::size_t lanes{64 / sizeof(T)}; //independent accumulators filling a 512bit register
+			T partial[lanes]{};
+			std::size_t i{0};
+			for(; i + lanes <= count; i += lanes)
+				for(std::size_t j{0}; j < lanes; ++j) partial[j] += values[i + j];
+
+			T result{};
+			for(; i < count; ++i) result += values[i];
+			for(const auto & value : partial) result += value;
+			return result;
+		}
+
+		template<typename T>
+		P2774_SIMD_INLINE
+		void add_impl(T * __restrict dst, const T * __restrict src, std::size_t count) noexcept {
+			for(std::size_t i{0}; i < count; ++i) dst[i] += src[i];
+		}
+	}
+
+#define P2774_SIMD_KERNELS(T) \
+	P2774_SIMD_DISPATCH auto sum(const T * values, std::size_t count) noexcept -> T { return sum_impl(values, count); } \
+	P2774_SIMD_DISPATCH void add(T * dst, const T * src, std::size_t count) noexcept { add_impl(dst, src, count); }
+
+	P2774_SIMD_KERNELS(float)
+	P2774_SIMD_KERNELS(double)
+	P2774_SIMD_KERNELS(int)
+	P2774_SIMD_KERNELS(unsigned)
+	P2774_SIMD_KERNELS(long)
+	P2774_SIMD_KERNELS(unsigned long)
+	P2774_SIMD_KERNELS(long long)
+	P2774_SIMD_KERNELS(unsigned long long)
+
+#undef P2774_SIMD_KERNELS
+}
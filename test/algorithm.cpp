@@ -0,0 +1,137 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <bit>
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+#include <optional>
+#include <numeric>
+#include <catch.hpp>
+#include <algorithm.hpp>
+
+namespace {
+	//hold count leases at once, so the pool contains (at least) count nodes
+	void lease_n(const auto & pool, std::size_t count, auto func, std::size_t index = 0) {
+		if(index == count) return;
+		const auto handle{pool.lease()};
+		func(index, *handle);
+		lease_n(pool, count, func, index + 1);
+	}
+}
+
+TEST_CASE("for_each", "[algorithm]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	p2774::for_each(std::execution::par, values, tls, [](std::size_t & local, std::size_t val) { local += val; });
+
+	REQUIRE(tls.active_node_count() != 0);
+	REQUIRE(tls.active_node_count() <= values.size());
+	const auto snapshot{tls.lease_all()};
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == reference);
+}
+
+TEST_CASE("transform_reduce", "[algorithm]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::transform_reduce(std::begin(values), std::end(values), std::size_t{0}, std::plus<>{}, [](auto val) { return val * 2; })};
+
+	p2774::object_pool<std::size_t> tls;
+	REQUIRE(p2774::transform_reduce(std::execution::par, values, tls, std::size_t{0}, std::plus<>{}, [](auto val) { return val * 2; }) == reference);
+	REQUIRE(p2774::transform_reduce(std::execution::par, values, tls, std::size_t{0}, std::plus<>{}, [](auto val) { return val * 2; }) == reference); //pool was reset
+
+	const std::vector<std::size_t> empty;
+	REQUIRE(p2774::transform_reduce(std::execution::seq, empty, tls, std::size_t{42}, std::plus<>{}, [](auto val) { return val; }) == 42);
+}
+
+TEST_CASE("reduce", "[algorithm]") {
+	using histogram = std::array<std::size_t, 16>;
+	const auto merge{[](histogram lhs, const histogram & rhs) {
+		for(std::size_t i{0}; i < lhs.size(); ++i) lhs[i] += rhs[i];
+		return lhs;
+	}};
+
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	histogram reference{};
+	for(auto val : values) ++reference[val % reference.size()];
+
+	p2774::object_pool<histogram> tls;
+	p2774::for_each(std::execution::par, values, tls, [](histogram & local, std::size_t val) { ++local[val % local.size()]; });
+
+	auto snapshot{tls.lease_all()};
+	REQUIRE(p2774::reduce(std::execution::par, snapshot, histogram{}, merge) == reference);
+}
+
+TEST_CASE("reduce over varying node counts", "[algorithm]") {
+	p2774::object_pool<std::size_t> tls;
+	for(std::size_t count{0}; count <= 17; ++count) { //cover odd and even tree shapes
+		lease_n(tls, count, [&](std::size_t index, std::size_t & value) { value = index + 1; });
+
+		auto snapshot{tls.lease_all()};
+		REQUIRE(p2774::reduce(std::execution::par, snapshot, std::size_t{1}, std::plus<>{}) == 1 + count * (count + 1) / 2);
+		REQUIRE(std::all_of(snapshot.begin(), snapshot.end(), [](std::size_t value) { return value == 0; })); //merged values are reset
+	}
+	REQUIRE(p2774::sum(tls.lease_all()) == 0);
+}
+
+TEMPLATE_TEST_CASE("sum", "[algorithm]", std::size_t, double, (std::array<float, 8>), (std::array<int, 3>)) {
+	const auto value_of{[](std::size_t index) {
+		if constexpr(std::is_arithmetic_v<TestType>) return static_cast<TestType>(index % 64);
+		else {
+			TestType result;
+			result.fill(static_cast<typename TestType::value_type>(index % 64));
+			return result;
+		}
+	}};
+
+	for(std::size_t count : {std::size_t{8}, std::size_t{100}, std::size_t{1'000}, std::size_t{10'000}}) {
+		p2774::object_pool<TestType> tls;
+		TestType reference{};
+		lease_n(tls, count, [&](std::size_t index, TestType & value) {
+			value = value_of(index);
+			if constexpr(std::is_arithmetic_v<TestType>) reference += value;
+			else for(std::size_t i{0}; i < reference.size(); ++i) reference[i] += value[i];
+		});
+
+		const auto snapshot{tls.lease_all()};
+		REQUIRE(p2774::sum(snapshot) == reference);
+	}
+}
+
+TEST_CASE("deterministic_reduce", "[algorithm]") {
+	using pool_type = p2774::object_pool<double>;
+	constexpr std::size_t count{1'000};
+
+	pool_type tls;
+	std::vector<std::unique_ptr<pool_type::handle>> handles;
+	for(std::size_t i{0}; i < count; ++i) handles.emplace_back(new pool_type::handle{tls.lease()});
+
+	std::mt19937 gen{42};
+	std::optional<double> reference;
+	for(auto round{0}; round < 10; ++round) {
+		for(auto & handle : handles) **handle = 1.0 / static_cast<double>(p2774::internal::stable_index(**handle) + 1); //value only depends on identity of node
+		std::shuffle(std::begin(handles), std::end(handles), gen);
+		handles.clear(); //release in random order => order of snapshot differs
+
+		{
+			auto snapshot{tls.lease_all()};
+			const auto result{p2774::deterministic_reduce(std::execution::par, snapshot, 0.0, std::plus<>{})};
+			if(reference) REQUIRE(std::bit_cast<std::uint64_t>(result) == std::bit_cast<std::uint64_t>(*reference));
+			else reference = result;
+			REQUIRE(p2774::sum(snapshot) == 0.0); //merged values are reset
+		}
+
+		for(std::size_t i{0}; i < count; ++i) handles.emplace_back(new pool_type::handle{tls.lease()});
+	}
+}
@@ -0,0 +1,160 @@
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <latch>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <execution>
+#include <catch.hpp>
+#include <bounded_object_pool.hpp>
+
+namespace {
+	using pool_type = p2774::bounded_object_pool<std::size_t>;
+
+	//starts eagerly and destroys itself on completion
+	struct task final {
+		struct promise_type final {
+			auto get_return_object() noexcept -> task { return {}; }
+			auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+			auto final_suspend() noexcept -> std::suspend_never { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+
+	//defers resumptions until they are run explicitly
+	struct queue final {
+		std::vector<std::coroutine_handle<>> * pending;
+
+		void operator()(std::coroutine_handle<> coroutine) const noexcept { pending->push_back(coroutine); }
+	};
+
+	auto increment(const pool_type & pool, queue executor, bool & done) -> task {
+		const auto handle{co_await pool.async_lease(executor)};
+		++*handle;
+		done = true;
+	}
+
+	//reports whether the lease failed instead of terminating
+	template<typename Pool>
+	auto try_increment(const Pool & pool, queue executor, bool & done, bool & failed) -> task {
+		try {
+			const auto handle{co_await pool.async_lease(executor)};
+			++*handle;
+			done = true;
+		} catch(...) {
+			failed = true;
+		}
+	}
+
+	template<typename Pool>
+	auto exhaust(const Pool & pool) -> std::vector<typename Pool::handle> {
+		std::vector<typename Pool::handle> handles;
+		while(auto handle{pool.try_lease()}) handles.push_back(std::move(*handle));
+		return handles;
+	}
+}
+
+TEST_CASE("bounded_object_pool", "[bounded_object_pool]") {
+	const pool_type pool{1};
+	auto handles{exhaust(pool)};
+	REQUIRE(!handles.empty());
+	const auto capacity{handles.size()}; //rounded up to a whole block
+
+	using namespace std::chrono_literals;
+	REQUIRE(!pool.try_lease_for(10ms));
+
+	std::latch started{1};
+	std::jthread waiter{[&] {
+		started.count_down();
+		const auto handle{pool.lease()}; //blocks until a handle is returned
+		*handle = 42;
+	}};
+	started.wait();
+	std::this_thread::sleep_for(10ms);
+	handles.pop_back();
+	waiter.join();
+
+	handles.clear();
+	const auto snapshot{pool.lease_all()};
+	REQUIRE(snapshot.size() == capacity);
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 42);
+}
+
+TEST_CASE("bounded_object_pool async_lease", "[bounded_object_pool]") {
+	const pool_type pool{1};
+	auto handles{exhaust(pool)};
+
+	std::vector<std::coroutine_handle<>> pending;
+	pending.reserve(1);
+	bool done{false};
+	increment(pool, {&pending}, done);
+	REQUIRE(!done); //suspended as the pool is at capacity
+	handles.pop_back(); //hands the node over and schedules the coroutine
+	REQUIRE(!done); //not resumed inside the destructor of the handle
+	REQUIRE(pending.size() == 1);
+	pending.back().resume();
+	REQUIRE(done);
+
+	pending.clear();
+	increment(pool, {&pending}, done); //doesn't suspend
+	REQUIRE(pending.empty());
+	handles.clear();
+	const auto snapshot{pool.lease_all()};
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 2);
+}
+
+TEST_CASE("bounded_object_pool failed handover", "[bounded_object_pool]") {
+	struct flaky final {
+		bool * fail;
+
+		auto operator()() const -> std::size_t {
+			if(std::exchange(*fail, false)) throw 0;
+			return 0;
+		}
+	};
+	bool fail{false};
+	const p2774::bounded_object_pool<std::size_t, std::allocator<std::size_t>, flaky> pool{1, flaky{&fail}};
+	auto handles{exhaust(pool)};
+
+	std::vector<std::coroutine_handle<>> pending;
+	pending.reserve(2);
+	bool done[2]{}, failed[2]{};
+	try_increment(pool, {&pending}, done[0], failed[0]);
+	try_increment(pool, {&pending}, done[1], failed[1]);
+	pool.new_generation();
+	fail = true;
+	handles.pop_back(); //handed over to the first coroutine
+	REQUIRE(pending.size() == 1);
+	pending[0].resume(); //resetting the stale value throws
+	REQUIRE(failed[0]);
+	REQUIRE(pending.size() == 2); //node was handed over to the next waiter
+	pending[1].resume();
+	REQUIRE(done[1]);
+}
+
+TEST_CASE("bounded_object_pool contention", "[bounded_object_pool]") {
+	std::vector<std::size_t> values(100'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	const pool_type pool{1};
+	const auto capacity{exhaust(pool).size()};
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		const auto handle{pool.lease()};
+		const auto other{pool.try_lease_for(std::chrono::microseconds{10})};
+		*handle += val;
+	});
+
+	const auto snapshot{pool.lease_all()};
+	REQUIRE(snapshot.size() <= capacity);
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == reference);
+}
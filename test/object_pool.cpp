@@ -4,7 +4,18 @@
 //    (See accompanying file ../LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
+#include <bit>
+#include <array>
+#include <latch>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <vector>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <optional>
 #include <iostream>
 #include <algorithm>
 #include <execution>
@@ -12,6 +23,14 @@
 #include <object_pool.hpp>
 
 namespace {
+	//hold count leases at once, so the pool contains (at least) count nodes
+	void lease_n(const auto & pool, std::size_t count, auto func, std::size_t index = 0) {
+		if(index == count) return;
+		const auto handle{pool.lease()};
+		func(index, *handle);
+		lease_n(pool, count, func, index + 1);
+	}
+
 	void print(const auto & pool) {
 		std::cout << "active nodes:   " << pool.active_node_count() << "\n";
 		std::cout << "reserved nodes: " << pool.reserved_node_count() << "\n";
@@ -44,3 +63,606 @@ TEST_CASE("object_pool", "[object_pool]") {
 }
 
 //TODO: further tests
+
+TEST_CASE("object_pool indexed snapshot", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*tls.lease() += val;
+	});
+
+	auto snapshot{tls.lease_all()};
+	auto indexed{snapshot.index()};
+	REQUIRE(indexed.size() == static_cast<std::size_t>(std::distance(snapshot.begin(), snapshot.end())));
+	REQUIRE(std::reduce(std::execution::par, indexed.begin(), indexed.end()) == reference);
+
+	std::for_each(std::execution::par, indexed.begin(), indexed.end(), [](auto & val) { val *= 2; });
+	const auto const_indexed{std::as_const(snapshot).index()};
+	REQUIRE(std::reduce(std::execution::par, const_indexed.begin(), const_indexed.end()) == 2 * reference);
+}
+
+TEST_CASE("object_pool snapshot size", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	REQUIRE(tls.lease_all().size() == 0);
+	REQUIRE(tls.lease_all().empty());
+
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+	for(auto round{0}; round < 3; ++round) {
+		std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+			*tls.lease() += val;
+		});
+
+		const auto active{tls.active_node_count()};
+		{
+			const auto snapshot{tls.lease_all()};
+			REQUIRE(snapshot.size() == active);
+			REQUIRE(static_cast<std::size_t>(std::distance(snapshot.begin(), snapshot.end())) == active);
+			{
+				{ const auto handle{tls.lease()}; } //returned onto the empty stack
+				const auto nested{tls.lease_all()};
+				REQUIRE(nested.size() == 1);
+			}
+			const auto handle{tls.lease()}; //snapshot is later returned onto a non-empty stack
+		}
+		REQUIRE(tls.active_node_count() == active + 1);
+		REQUIRE(tls.lease_all().size() == active + 1);
+	}
+
+	p2774::object_pool<std::size_t> small;
+	for(std::size_t round{0}; round < 50; ++round) { //snapshots are returned onto clean, which is partially leased again
+		lease_n(small, round % 7 + 1, [](std::size_t, std::size_t &) {});
+		const auto snapshot{round % 5 ? small.lease_dirty() : small.lease_all()};
+		REQUIRE(snapshot.size() == static_cast<std::size_t>(std::distance(snapshot.begin(), snapshot.end())));
+	}
+	const auto active{small.active_node_count()};
+	REQUIRE(small.lease_all().size() == active);
+}
+
+TEST_CASE("object_pool ordered snapshot traversal", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*tls.lease() += val;
+	});
+
+	auto snapshot{tls.lease_all()};
+	std::size_t count{0}, sum{0};
+	std::optional<std::size_t> previous;
+	std::as_const(snapshot).for_each_ordered([&](const std::size_t & val) {
+		const auto index{p2774::internal::stable_index(val)};
+		REQUIRE((!previous || *previous < index));
+		previous = index;
+		++count;
+		sum += val;
+	});
+	REQUIRE(count == snapshot.size());
+	REQUIRE(sum == reference);
+
+	snapshot.for_each_ordered([](std::size_t & val) { val = 1; }); //reuses the recorded nodes
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == snapshot.size());
+
+	const auto moved{std::move(snapshot)};
+	count = 0;
+	moved.for_each_ordered([&](std::size_t) { ++count; });
+	REQUIRE(count == moved.size());
+}
+
+TEST_CASE("object_pool block-wise snapshot traversal", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*tls.lease() += val;
+	});
+
+	{
+		auto snapshot{tls.lease_all()};
+		std::size_t count{0}, sum{0};
+		std::optional<std::uint32_t> previous;
+		std::as_const(snapshot).for_each_block([&](const auto & nodes) {
+			for(const auto & val : nodes) {
+				++count;
+				sum += val;
+			}
+			REQUIRE(nodes.size() <= nodes.nodes().size());
+			const auto index{p2774::internal::block_of<std::size_t>(nodes.nodes().data())->index};
+			REQUIRE((!previous || *previous < index)); //each block once, in allocation order
+			previous = index;
+		});
+		REQUIRE(count == snapshot.size());
+		REQUIRE(count < tls.block_count() * p2774::internal::nodes_per_block<std::size_t>); //reserved nodes are skipped
+		REQUIRE(sum == reference);
+	}
+
+	const auto handle{tls.lease()}; //neither leased nor clean nodes are part of the snapshot
+	{ const auto other{tls.lease()}; *other = 3; }
+	const auto dirty{tls.lease_dirty()};
+	REQUIRE(dirty.size() == 1);
+	std::size_t visited{0};
+	dirty.for_each_block([&](const auto & nodes) {
+		for(const auto & val : nodes) REQUIRE(val == 3);
+		visited += nodes.size();
+		REQUIRE(std::popcount(nodes.mask()) == static_cast<int>(nodes.size()));
+	});
+	REQUIRE(visited == 1);
+}
+
+TEST_CASE("object_pool snapshot export", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*tls.lease() += val;
+	});
+
+	auto snapshot{tls.lease_all()};
+	std::vector<std::size_t> sequential(snapshot.size()), parallel(snapshot.size()), moved(snapshot.size());
+	REQUIRE(std::as_const(snapshot).copy_to(sequential) == snapshot.size());
+	REQUIRE(std::accumulate(std::begin(sequential), std::end(sequential), std::size_t{0}) == reference);
+	REQUIRE(std::equal(std::begin(sequential), std::end(sequential), snapshot.begin()));
+
+	REQUIRE(std::as_const(snapshot).copy_to(std::execution::par, parallel) == snapshot.size());
+	REQUIRE(parallel == sequential);
+
+	REQUIRE(snapshot.move_to(std::execution::par, moved) == snapshot.size());
+	REQUIRE(moved == sequential);
+}
+
+TEST_CASE("object_pool snapshot export of non-trivial values", "[object_pool]") {
+	p2774::object_pool<std::vector<int>> tls;
+	{
+		const auto h0{tls.lease()};
+		const auto h1{tls.lease()};
+		h0->assign(3, 1);
+		h1->assign(5, 2);
+	}
+
+	auto snapshot{tls.lease_all()};
+	std::vector<std::vector<int>> copied(snapshot.size()), moved(snapshot.size());
+	REQUIRE(snapshot.copy_to(copied) == 2);
+	REQUIRE(snapshot.move_to(moved) == 2);
+	REQUIRE(moved == copied);
+	REQUIRE(std::all_of(snapshot.begin(), snapshot.end(), [](const auto & val) { return val.empty(); }));
+}
+
+TEST_CASE("object_pool epochs", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	{
+		const auto handle{tls.lease()};
+		REQUIRE(tls.lease_all().empty()); //doesn't wait for handles
+		*handle = 1;
+	}
+
+	std::latch leased{1}, requested{1};
+	std::thread worker{[&] {
+		const auto handle{tls.lease()};
+		leased.count_down();
+		requested.wait();
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});
+		*handle += 41; //modified after lease_epoch() was called
+	}};
+
+	leased.wait();
+	const auto pending{tls.lease_epoch()};
+	REQUIRE(!pending.ready());
+	requested.count_down();
+	{ const auto handle{tls.lease()}; *handle = 5; } //leased in the new epoch
+	{
+		const auto snapshot{pending.get()};
+		REQUIRE(pending.ready());
+		REQUIRE(snapshot.size() == 1);
+		REQUIRE(*snapshot.begin() == 42);
+	}
+	worker.join();
+
+	const auto snapshot{tls.lease_all()};
+	REQUIRE(snapshot.size() == 2);
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 47);
+}
+
+TEST_CASE("object_pool epochs don't lease from a closed epoch", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	{ const auto handle{tls.lease()}; *handle = 1; }
+	const auto pending{tls.lease_epoch()};
+	{ const auto handle{tls.lease()}; *handle += 2; } //must not take the node of the closed epoch
+	{
+		const auto snapshot{pending.get()};
+		REQUIRE(snapshot.size() == 1);
+		REQUIRE(*snapshot.begin() == 1);
+	}
+	const auto snapshot{tls.lease_all()};
+	REQUIRE(snapshot.size() == 2);
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 3);
+}
+
+TEST_CASE("object_pool lease_all_wait waits for prior leases", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	{ //populate both epochs
+		{ const auto handle{tls.lease()}; }
+		const auto snapshot{tls.lease_epoch().get()};
+		const auto handle{tls.lease()};
+	}
+	REQUIRE(tls.active_node_count() == 2);
+
+	std::latch leased{3};
+	std::vector<std::thread> workers;
+	for(auto i{0}; i < 3; ++i)
+		workers.emplace_back([&] {
+			const auto handle{tls.lease()};
+			leased.count_down();
+			std::this_thread::sleep_for(std::chrono::milliseconds{50});
+			*handle = 1;
+		});
+
+	leased.wait();
+	{
+		const auto snapshot{tls.lease_all_wait()};
+		REQUIRE(snapshot.size() == 3);
+		REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 3);
+	}
+	for(auto & worker : workers) worker.join();
+
+	std::atomic<bool> stop{false};
+	std::thread churn{[&] {
+		auto handle{tls.lease()};
+		while(!stop) handle = tls.lease(); //a handle is alive at all times
+	}};
+	std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	for(auto i{0}; i < 10; ++i) (void)tls.lease_all_wait(); //leases after the call are not waited for
+	stop = true;
+	churn.join();
+}
+
+template<typename T>
+concept peekable = requires(const p2774::object_pool<T> & pool, void (*func)(T)) { pool.peek(func); };
+
+TEST_CASE("object_pool peek", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	{
+		const auto h0{tls.lease()};
+		const auto h1{tls.lease()};
+		*h0 = 1;
+		*h1 = 2;
+
+		std::size_t sum{0}, count{0};
+		tls.peek([&](std::size_t val) {
+			sum += val;
+			++count;
+		});
+		REQUIRE(count == 2); //leased nodes are visible
+		REQUIRE(sum == 3);
+	}
+	REQUIRE(tls.active_node_count() == 2); //nothing was taken
+
+	using large = std::array<std::size_t, 4>; //can't be read atomically
+	static_assert(!peekable<large>);
+}
+
+TEST_CASE("object_pool incremental snapshots", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	lease_n(tls, 10, [](std::size_t, std::size_t & value) { value = 1; });
+	REQUIRE(tls.lease_dirty().size() == 10);
+	REQUIRE(tls.lease_dirty().empty()); //nothing touched since
+
+	{ const auto handle{tls.lease()}; ++*handle; }
+	{ const auto handle{tls.lease()}; ++*handle; } //same node again
+	{
+		const auto dirty{tls.lease_dirty()};
+		REQUIRE(dirty.size() == 1);
+		REQUIRE(*dirty.begin() == 3);
+	}
+	REQUIRE(tls.lease_dirty().empty());
+	REQUIRE(tls.lease_all().size() == 10); //full snapshots are unaffected
+
+	lease_n(tls, 3, [](std::size_t, std::size_t &) {});
+	REQUIRE(tls.lease_dirty().size() == 3);
+}
+
+TEST_CASE("object_pool consuming snapshot", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	for(auto target : {p2774::return_to::active, p2774::return_to::reserved, p2774::return_to::active}) {
+		std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+			*tls.lease() += val;
+		});
+
+		std::size_t sum{0};
+		tls.lease_all().consume([&](std::size_t val) { sum += val; }, target);
+		REQUIRE(sum == reference);
+		if(target == p2774::return_to::reserved) REQUIRE(tls.active_node_count() == 0);
+		else REQUIRE(tls.active_node_count() != 0);
+	}
+
+	p2774::object_pool<std::vector<int>> vectors;
+	{ const auto handle{vectors.lease()}; handle->assign(3, 1); }
+	std::vector<int> moved;
+	vectors.lease_all().consume([&](std::vector<int> && val) { moved = std::move(val); });
+	REQUIRE(moved.size() == 3);
+	const auto snapshot{vectors.lease_all()};
+	REQUIRE(std::all_of(snapshot.begin(), snapshot.end(), [](const auto & val) { return val.empty(); }));
+}
+
+TEST_CASE("object_pool generations", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	lease_n(tls, 10, [](std::size_t index, std::size_t & value) { value = index + 1; });
+	REQUIRE(tls.lease_all().size() == 10);
+
+	tls.new_generation();
+	REQUIRE(tls.lease_all().empty()); //all values are stale
+	std::size_t peeked{0};
+	tls.peek([&](std::size_t) { ++peeked; });
+	REQUIRE(peeked == 0);
+
+	lease_n(tls, 3, [](std::size_t, std::size_t & value) { REQUIRE(value == 0); ++value; }); //reset lazily
+	{
+		const auto snapshot{tls.lease_all()};
+		REQUIRE(snapshot.size() == 3);
+		REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 3);
+	}
+
+	{
+		const auto handle{tls.lease()}; //in-flight across the boundary
+		tls.new_generation();
+		*handle = 7;
+	}
+	{ const auto other{tls.lease()}; REQUIRE(*other == 0); *other = 5; }
+	std::size_t blocks{0};
+	tls.lease_all().for_each_block([&](const auto & nodes) { blocks += nodes.size(); });
+	REQUIRE(blocks == 1);
+
+	p2774::object_pool<std::atomic<std::size_t>> counters; //reset without assignment
+	{ const auto handle{counters.lease()}; handle->store(3); }
+	counters.new_generation();
+	REQUIRE(counters.lease()->load() == 0);
+}
+
+namespace {
+	struct counted final {
+		inline
+		static
+		std::size_t alive{0};
+
+		counted() noexcept { ++alive; }
+		counted(const counted &) noexcept { ++alive; }
+		auto operator=(const counted &) noexcept -> counted & =default;
+		~counted() noexcept { --alive; }
+	};
+}
+
+TEST_CASE("object_pool lazy construction", "[object_pool]") {
+	{
+		p2774::object_pool<counted> pool;
+		REQUIRE(counted::alive == 0);
+		{ const auto handle{pool.lease()}; }
+		REQUIRE(counted::alive == 1); //only the leased node
+		lease_n(pool, 3, [](std::size_t, counted &) {});
+		REQUIRE(counted::alive == 3);
+		REQUIRE(pool.block_count() == 1);
+	}
+	REQUIRE(counted::alive == 0);
+}
+
+TEST_CASE("object_pool for overwrite", "[object_pool]") {
+	using histogram = std::array<std::uint64_t, 4096>; //larger than a regular block
+	p2774::object_pool<histogram> histograms{p2774::for_overwrite};
+	lease_n(histograms, 4, [](std::size_t index, histogram & value) { value.fill(index); }); //values are uninitialized until written
+	lease_n(histograms, 4, [](std::size_t, histogram & value) { ++value.back(); });
+
+	std::uint64_t sum{0};
+	for(const auto & value : histograms.lease_all()) sum += value.front() + value.back();
+	REQUIRE(sum == 2 * (0 + 1 + 2 + 3) + 4);
+}
+
+TEST_CASE("object_pool prototype", "[object_pool]") {
+	struct bins final {
+		std::vector<std::size_t> counts;
+
+		explicit
+		bins(std::size_t count) : counts(count) {}
+	};
+	static_assert(!std::default_initializable<bins>);
+
+	p2774::object_pool<bins> prototyped{bins{8}};
+	lease_n(prototyped, 3, [](std::size_t index, bins & value) { REQUIRE(value.counts.size() == 8); ++value.counts[index]; });
+	prototyped.lease_all().consume([](bins && value) { REQUIRE(value.counts.size() == 8); });
+	for(const auto & value : prototyped.lease_all()) REQUIRE(std::accumulate(value.counts.begin(), value.counts.end(), std::size_t{0}) == 0); //reset to prototype
+
+	p2774::object_pool manufactured{[] { return bins{4}; }}; //factory is part of the type
+	{ const auto handle{manufactured.lease()}; handle->counts.push_back(1); }
+	manufactured.new_generation();
+	{ const auto handle{manufactured.lease()}; REQUIRE(handle->counts.size() == 4); }
+
+	std::size_t calls{0};
+	p2774::object_pool counting{[&] { ++calls; return bins{2}; }};
+	{ const auto handle{counting.lease()}; }
+	counting.new_generation();
+	lease_n(counting, 2, [](std::size_t, bins &) {});
+	REQUIRE(calls == 3); //one reset and one construction, values constructed after new_generation are not reset again
+
+	p2774::object_pool<std::size_t> ones{std::size_t{1}};
+	lease_n(ones, 5, [](std::size_t, std::size_t &) {});
+	const auto snapshot{ones.lease_all()};
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 5);
+
+	p2774::object_pool move_only{[scale = std::make_unique<std::size_t>(3)] { return *scale; }};
+	{ const auto handle{move_only.lease()}; REQUIRE(*handle == 3); *handle = 0; }
+	move_only.lease_all().consume([](std::size_t && value) { REQUIRE(value == 0); });
+	REQUIRE(*move_only.lease() == 3); //reset by the factory
+
+	struct zero final {
+		auto operator()() const noexcept -> std::size_t { return 0; }
+	};
+	static_assert(std::is_nothrow_constructible_v<p2774::object_pool<std::size_t, std::allocator<std::size_t>, zero>>); //default-constructed factory
+
+	p2774::object_pool<std::unique_ptr<std::size_t>> owning; //not copyable, so there is no prototype
+	{ const auto handle{owning.lease()}; *handle = std::make_unique<std::size_t>(1); }
+	owning.lease_all().consume([](std::unique_ptr<std::size_t> && value) { REQUIRE(*value == 1); });
+	REQUIRE(!*owning.lease());
+}
+
+TEST_CASE("object_pool movable handles and snapshots", "[object_pool]") {
+	using pool_type = p2774::object_pool<std::size_t>;
+	pool_type tls;
+	{
+		std::vector<pool_type::handle> handles;
+		for(std::size_t i{0}; i < 10; ++i) handles.push_back(tls.lease());
+		for(auto & handle : handles) *handle = 1;
+
+		std::optional<pool_type::handle> optional{tls.lease()};
+		pool_type::handle moved{std::move(*optional)};
+		REQUIRE(!*optional);
+		*moved = 2;
+		moved = std::move(handles.back()); //returns the previous node
+		REQUIRE(!handles.back());
+	}
+
+	const auto take{[&] { return tls.lease_all(); }};
+	pool_type::snapshot snapshot;
+	REQUIRE(snapshot.empty());
+	snapshot = take();
+	REQUIRE(snapshot.size() == 11);
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == 12);
+
+	auto other{std::move(snapshot)};
+	REQUIRE(snapshot.empty());
+	REQUIRE(other.size() == 11);
+	other = {}; //returns the nodes
+	REQUIRE(tls.active_node_count() == 11);
+}
+
+TEST_CASE("object_pool with", "[object_pool]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	p2774::object_pool<std::size_t> tls;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		tls.with([&](std::size_t & local) noexcept { local += val; });
+	});
+	REQUIRE(tls.active_node_count() != 0);
+
+	REQUIRE_THROWS(tls.with([](std::size_t & local) { local += 1; throw 0; }));
+	const auto snapshot{tls.lease_all()}; //node was returned despite the exception
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == reference + 1);
+}
+
+TEST_CASE("object_pool reserve and shrink", "[object_pool]") {
+	p2774::object_pool<std::size_t> tls;
+	REQUIRE(tls.shrink_to_fit() == 0);
+
+	tls.reserve(100);
+	const auto blocks{tls.block_count()};
+	REQUIRE(blocks != 0);
+	REQUIRE(tls.reserved_node_count() >= 100);
+	tls.reserve(50);
+	REQUIRE(tls.block_count() == blocks);
+
+	lease_n(tls, 100, [](std::size_t, std::size_t & value) { value = 1; });
+	REQUIRE(tls.block_count() == blocks); //no growth
+	REQUIRE(tls.shrink_to_fit() == 0); //every block contains active nodes
+
+	tls.lease_all().consume([](std::size_t) {}, p2774::return_to::reserved);
+	std::size_t peeked{0}, deferred{0};
+	tls.peek([&](std::size_t) { if(!peeked++) deferred = tls.shrink_to_fit(); });
+	REQUIRE(peeked == 100); //blocks removed while being visited are not freed
+	REQUIRE(deferred == 0);
+	REQUIRE(tls.block_count() == 1); //embedded block is kept
+	REQUIRE(tls.shrink_to_fit() == (blocks - 1) * sizeof(p2774::internal::block<std::size_t>)); //freed by the next call
+	REQUIRE(tls.reserved_node_count() == p2774::internal::nodes_per_block<std::size_t>);
+
+	{ const auto handle{tls.lease()}; *handle = 2; } //pool is still usable
+	{
+		const auto snapshot{tls.lease_all()};
+		REQUIRE(snapshot.size() == 1);
+		REQUIRE(*snapshot.begin() == 2);
+	}
+
+	tls.reserve(100);
+	std::size_t kept;
+	{
+		const auto handle{tls.lease()};
+		REQUIRE(tls.shrink_to_fit() == 0); //doesn't wait for the handle of the calling thread
+		kept = tls.block_count();
+		REQUIRE(kept < blocks);
+	}
+	REQUIRE(tls.shrink_to_fit() == (blocks - kept) * sizeof(p2774::internal::block<std::size_t>));
+}
+
+namespace {
+	template<typename T>
+	struct counting_allocator final {
+		using value_type = T;
+
+		std::size_t * allocations;
+
+		counting_allocator(std::size_t & allocations) noexcept : allocations{&allocations} {}
+		template<typename U>
+		counting_allocator(const counting_allocator<U> & other) noexcept : allocations{other.allocations} {}
+
+		auto allocate(std::size_t count) -> T * {
+			++*allocations;
+			return std::allocator<T>{}.allocate(count);
+		}
+		void deallocate(T * ptr, std::size_t count) noexcept { std::allocator<T>{}.deallocate(ptr, count); }
+
+		friend
+		auto operator==(const counting_allocator &, const counting_allocator &) noexcept -> bool =default;
+	};
+}
+
+TEST_CASE("object_pool embedded block", "[object_pool]") {
+	std::size_t allocations{0};
+	p2774::object_pool<std::size_t, counting_allocator<std::size_t>> tls{counting_allocator<std::size_t>{allocations}};
+	lease_n(tls, 2, [](std::size_t index, std::size_t & value) { value = index; });
+	REQUIRE(allocations == 0);
+	REQUIRE(tls.block_count() == 1);
+
+	lease_n(tls, 100, [](std::size_t, std::size_t &) {});
+	REQUIRE(allocations != 0); //chained heap blocks
+	REQUIRE(tls.lease_all().size() == 100);
+}
+
+namespace {
+	//returns storage that is only aligned to 8 bytes
+	template<typename T>
+	struct misaligned_allocator final {
+		using value_type = T;
+
+		misaligned_allocator() noexcept =default;
+		template<typename U>
+		misaligned_allocator(const misaligned_allocator<U> &) noexcept {}
+
+		auto allocate(std::size_t count) -> T * { return std::bit_cast<T *>(static_cast<std::byte *>(::operator new(count * sizeof(T) + 8)) + 8); }
+		void deallocate(T * ptr, std::size_t count) noexcept { ::operator delete(std::bit_cast<std::byte *>(ptr) - 8, count * sizeof(T) + 8); }
+
+		friend
+		auto operator==(const misaligned_allocator &, const misaligned_allocator &) noexcept -> bool =default;
+	};
+}
+
+TEST_CASE("object_pool misaligned allocator", "[object_pool]") {
+	p2774::object_pool<std::size_t, misaligned_allocator<std::size_t>> tls;
+	REQUIRE_THROWS_AS(tls.reserve(100), std::bad_alloc); //the embedded block is aligned, heap blocks are rejected
+	{ const auto handle{tls.lease()}; *handle = 1; }
+	REQUIRE(tls.lease_all().size() == 1);
+}
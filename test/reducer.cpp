@@ -0,0 +1,54 @@
+
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <execution>
+#include <catch.hpp>
+#include <reducer.hpp>
+
+namespace {
+	struct zero final {
+		auto operator()() const noexcept -> std::size_t { return 0; }
+	};
+
+	struct one final {
+		auto operator()() const noexcept -> std::size_t { return 1; }
+	};
+}
+
+TEST_CASE("reducer", "[reducer]") {
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), std::size_t{0})};
+
+	static_assert(std::is_nothrow_default_constructible_v<p2774::reducer<std::size_t, zero>>);
+	p2774::reducer<std::size_t, zero> sum;
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*sum.local() += val;
+	});
+	REQUIRE(sum.combine() == reference);
+	REQUIRE(sum.combine() == 0); //accumulators were reset
+
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		*sum.local() += val;
+	});
+	REQUIRE(sum.combine(std::execution::par) == reference);
+	REQUIRE(sum.combine(std::execution::par) == 0);
+}
+
+TEST_CASE("reducer with non-zero identity", "[reducer]") {
+	const std::vector<std::size_t> factors{2, 3, 4, 5};
+
+	p2774::reducer<std::size_t, one, std::multiplies<>> product;
+	std::for_each(std::execution::par, std::begin(factors), std::end(factors), [&](auto val) {
+		*product.local() *= val;
+	});
+	REQUIRE(product.combine() == 120);
+	REQUIRE(product.combine() == 1);
+}
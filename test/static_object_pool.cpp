@@ -0,0 +1,76 @@
+//          Copyright Michael Florian Hava.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <execution>
+#include <catch.hpp>
+#include <static_object_pool.hpp>
+
+TEST_CASE("static_object_pool", "[static_object_pool]") {
+	using pool_type = p2774::static_object_pool<std::size_t, 40>;
+	static_assert(pool_type::capacity() >= 40);
+
+	pool_type pool;
+	{
+		std::vector<pool_type::handle> handles;
+		while(auto handle{pool.try_lease()}) handles.push_back(std::move(*handle));
+		REQUIRE(handles.size() == pool_type::capacity());
+		for(auto & handle : handles) *handle = 1;
+	}
+	{
+		const auto snapshot{pool.lease_all()};
+		REQUIRE(snapshot.size() == pool_type::capacity());
+		REQUIRE(!pool.try_lease()); //all nodes are part of snapshot
+	}
+
+	std::vector<std::size_t> values(1'000'000);
+	std::iota(std::begin(values), std::end(values), 0);
+
+	const auto reference{std::accumulate(std::begin(values), std::end(values), pool_type::capacity())};
+
+	std::atomic<std::size_t> rejected{0};
+	std::for_each(std::execution::par, std::begin(values), std::end(values), [&](auto val) {
+		if(const auto handle{pool.try_lease()}) **handle += val;
+		else rejected += val;
+	});
+
+	const auto snapshot{pool.lease_all()};
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), rejected.load()) == reference);
+}
+
+TEST_CASE("static_object_pool prototype", "[static_object_pool]") {
+	const p2774::static_object_pool<std::vector<int>, 3> pool{std::vector<int>(4)};
+	const auto handle{pool.try_lease()};
+	REQUIRE(handle);
+	REQUIRE((*handle)->size() == 4);
+}
+
+namespace {
+	struct counting_factory final {
+		inline
+		static
+		std::size_t calls{0};
+
+		auto operator()() const noexcept -> std::size_t { ++calls; return 1; }
+	};
+}
+
+TEST_CASE("static_object_pool eager construction", "[static_object_pool]") {
+	using pool_type = p2774::static_object_pool<std::size_t, 10, counting_factory>;
+	const pool_type pool;
+	REQUIRE(counting_factory::calls == pool_type::capacity()); //all values are constructed upfront
+	{
+		std::vector<pool_type::handle> handles;
+		while(auto handle{pool.try_lease()}) handles.push_back(std::move(*handle));
+		REQUIRE(handles.size() == pool_type::capacity());
+	}
+	REQUIRE(counting_factory::calls == pool_type::capacity()); //leases don't construct
+
+	const auto snapshot{pool.lease_all()};
+	REQUIRE(std::accumulate(snapshot.begin(), snapshot.end(), std::size_t{0}) == pool_type::capacity());
+}